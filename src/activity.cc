@@ -0,0 +1,36 @@
+#include <raylib-cpp.hpp>
+
+#include "globals.hh"
+#include "components.hh"
+#include "systems.hh"
+#include "camera.hh"
+
+// The gap between the margins stops entities near the edge from switching every step
+const float wake_margin = 640.0; // Distance outside the view where dormant entities wake up
+const float sleep_margin = 1280.0; // Distance outside the view where entities go dormant
+
+static raylib::Rectangle grow(const raylib::Rectangle& area, float margin) {
+	return raylib::Rectangle(
+		area.x - margin,
+		area.y - margin,
+		area.width + margin * 2,
+		area.height + margin * 2
+	);
+}
+
+void update_activity() {
+	const raylib::Rectangle view_area = CameraSystem::get_view_area();
+	const raylib::Rectangle wake_area = grow(view_area, wake_margin);
+	const raylib::Rectangle sleep_area = grow(view_area, sleep_margin);
+
+	for ( auto [entity, character, position] : registry.view<const Character, const Position>().each() ) {
+		if (entity == player) continue; // The player is always simulated
+
+		const bool dormant = registry.all_of<Dormant>(entity);
+
+		if ( dormant && wake_area.CheckCollision(position.value) )
+			registry.remove<Dormant>(entity);
+		else if ( !dormant && !sleep_area.CheckCollision(position.value) )
+			registry.emplace<Dormant>(entity);
+	}
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cmath>
+#include <limits>
 #include <raylib-cpp.hpp>
 
 #include "globals.hh"
@@ -8,21 +9,53 @@
 #include "util.hh"
 #include "audio.hh"
 
-// Checks for line of sight between two tile coordinates
+// Checks for line of sight between the centers of two tiles
 bool line_of_sight(const TileCoord a, const TileCoord b) {
 	TileCoord c = a;
 
+	const int dx = b.x - a.x;
+	const int dy = b.y - a.y;
+	const int step_x = sign(dx);
+	const int step_y = sign(dy);
+
+	// Time to cross one tile along the line, and to reach the next tile edge from the center
+	const float never = std::numeric_limits<float>::infinity();
+	const float delta_x = dx != 0? 1.0 / abs(dx) : never;
+	const float delta_y = dy != 0? 1.0 / abs(dy) : never;
+	float next_x = delta_x / 2;
+	float next_y = delta_y / 2;
+
 	while (c.x != b.x || c.y != b.y) {
-		// Move towards the destination
-		c.x += sign(b.x - c.x);
-		c.y += sign(b.y - c.y);
+		// Step into whichever tile the line enters first
+		if (next_x < next_y) {
+			c.x += step_x;
+			next_x += delta_x;
+		} else {
+			c.y += step_y;
+			next_y += delta_y;
+		}
 
 		if (c.x == b.x && c.y == b.y) return true; // Return true if the destination is reached
 		if ( !tilemap.tile_in_map(c) ) return false; // Return false if it gets to the edge of the map
-		if ( tilemap(c) != empty_tile ) return false; // If a tile in the way isn't empty then there is no line of sight
+		if ( tilemap.solid(c) ) return false; // If a tile in the way isn't empty then there is no line of sight
+	}
+
+	return true;
+}
+
+bool GuardBrain::can_see(const TileCoord from, const TileCoord to) {
+	// Only trace the line again when either end has moved to a different tile
+	const bool moved =
+		from.x != sight_from.x || from.y != sight_from.y ||
+		to.x != sight_to.x || to.y != sight_to.y;
+
+	if (moved) {
+		sight_from = from;
+		sight_to = to;
+		sight = line_of_sight(from, to);
 	}
 
-	return false;
+	return sight;
 }
 
 Vector2 GuardBrain::find_player() {
@@ -67,7 +100,7 @@ void GuardBrain::think() {
 	Vector2 player_position = find_player();
 	TileCoord player_coord = tilemap.world_to_tile(player_position);
 	TileCoord entity_coord = tilemap.world_to_tile(position.value.x, position.value.y-collider.height);
-	if ( !line_of_sight(entity_coord, player_coord) ) {
+	if ( !can_see(entity_coord, player_coord) ) {
 		movement.direction.x = 0;
 		return;
 	}
@@ -86,7 +119,7 @@ void GuardBrain::think() {
 	const TileCoord next_tile = tilemap.world_to_tile( position.value.x+(direction*(collider.width+3)/2), position.value.y+1 );
 
 	// Don't walk off a ledge if the player is above
-	if ( tilemap(next_tile) == empty_tile && player_position.y < position.value.y )
+	if ( !tilemap.solid(next_tile) && player_position.y < position.value.y )
 		movement.direction.x = 0;
 
 	// If the player if in attack_range and the GunAttack timer <= 0, stop moving and attack them
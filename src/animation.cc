@@ -3,6 +3,7 @@
 #include "systems.hh"
 #include "globals.hh"
 #include "components.hh"
+#include "jobs.hh"
 
 // Check if they have an active attack
 Weapon* get_active_weapon(entt::entity entity) {
@@ -15,9 +16,10 @@ Weapon* get_active_weapon(entt::entity entity) {
 }
 
 void animate_character() {
-	auto view = registry.view<AnimationState, const Character, const Velocity, const Collider, const Health>();
+	auto view = registry.view<AnimationState, const Character, const Velocity, const Collider, const Health>(entt::exclude<Dormant>);
 
-	for ( auto [entity, animation, character, velocity, collider, health] : view.each() ) {
+	parallel_each(view, [&](entt::entity entity) {
+		auto [animation, character, velocity, collider, health] = view.get<AnimationState, const Character, const Velocity, const Collider, const Health>(entity);
 		Weapon* weapon = get_active_weapon(entity);
 
 		if (health.now <= 0) animation.set_state(DIE);
@@ -28,5 +30,5 @@ void animate_character() {
 		else if ( collider.wall_direction != 0 && !collider.on_floor ) animation.set_state(WALL_SLIDE);
 		else if ( !collider.on_floor ) animation.set_state(FALL);
 		else animation.set_state(IDLE);
-	}
+	});
 }
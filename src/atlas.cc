@@ -0,0 +1,148 @@
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <raylib-cpp.hpp>
+#include <rlgl.h>
+
+#include "atlas.hh"
+#include "render_queue.hh"
+#include "renderer.hh"
+
+AtlasImage Atlas::add(const Image& image, Rectangle source) {
+	Entry entry;
+	entry.image = ImageFromImage(image, source);
+	ImageFormat(&entry.image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8); // Pages are copied row by row
+	entry.rect = { 0, 0, source.width, source.height };
+
+	entries.push_back(entry);
+	return entries.size() - 1;
+}
+
+AtlasImage Atlas::add(const std::string filename) {
+	Image image = LoadImage( filename.c_str() );
+	AtlasImage added = add( image, { 0, 0, (float)image.width, (float)image.height } );
+	UnloadImage(image);
+
+	return added;
+}
+
+int Atlas::pack() {
+	struct Shelf {
+		int page, y, height;
+		int x = 0; // Start of the free space
+	};
+
+	std::vector<Shelf> shelves;
+	std::vector<int> page_tops; // Start of the free space below the shelves of each page
+
+	// Rounding to the padding keeps images on the same texels at each mipmap level
+	auto cell = [](float size) { return ( int(size) + padding * 2 + padding - 1 ) / padding * padding; };
+
+	// Tall images first, so each shelf is mostly filled by images of about its height
+	std::vector<int> order( entries.size() );
+	for (size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::stable_sort( order.begin(), order.end(), [](int a, int b) { return entries[a].rect.height > entries[b].rect.height; } );
+
+	for (int i : order) {
+		Entry& entry = entries[i];
+		const int width = cell(entry.rect.width);
+		const int height = cell(entry.rect.height);
+
+		if (width > page_size || height > page_size) {
+			std::cerr << "Atlas: " << entry.rect.width << "x" << entry.rect.height << " image is larger than a page\n";
+			continue;
+		}
+
+		auto shelf = std::find_if( shelves.begin(), shelves.end(), [&](const Shelf& s) { return s.height >= height && s.x + width <= page_size; } );
+
+		// Start a shelf below the others, or on a new page
+		if ( shelf == shelves.end() ) {
+			auto page = std::find_if( page_tops.begin(), page_tops.end(), [&](int top) { return top + height <= page_size; } );
+			if ( page == page_tops.end() ) page = page_tops.insert( page_tops.end(), 0 );
+
+			shelves.push_back( { int( page - page_tops.begin() ), *page, height } );
+			*page += height;
+			shelf = shelves.end() - 1;
+		}
+
+		entry.page = shelf->page;
+		entry.rect.x = shelf->x + padding;
+		entry.rect.y = shelf->y + padding;
+		shelf->x += width;
+	}
+
+	return page_tops.size();
+}
+
+void Atlas::build() {
+	const int page_count = pack();
+
+	for (int page = 0; page < page_count; page++) {
+		// Pages are cut to the used height, kept at a power of two for mipmaps on the web
+		int height = 1;
+		for (const auto& entry : entries)
+			if (entry.page == page) height = std::max( height, int(entry.rect.y + entry.rect.height) + padding );
+		int page_height = 1;
+		while (page_height < height) page_height *= 2;
+
+		// Without a GPU the page only needs an id, so draws can still be counted
+		if ( !Renderer::has_gpu() ) {
+			pages.push_back( Renderer::placeholder_texture(page_size, page_height) );
+			continue;
+		}
+
+		Image image = GenImageColor(page_size, page_height, BLANK);
+		for (auto& entry : entries) {
+			if (entry.page != page) continue;
+
+			const int row_bytes = entry.image.width * 4;
+			for (int y = 0; y < entry.image.height; y++) {
+				memcpy(
+					(unsigned char*)image.data + ( ( int(entry.rect.y) + y ) * page_size + int(entry.rect.x) ) * 4,
+					(unsigned char*)entry.image.data + y * row_bytes,
+					row_bytes
+				);
+			}
+		}
+
+		Texture2D texture = LoadTextureFromImage(image);
+		UnloadImage(image);
+
+		// Smooth when zoomed out, but pixels stay sharp when zoomed in
+		GenTextureMipmaps(&texture);
+		SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+		rlTextureParameters(texture.id, RL_TEXTURE_MAG_FILTER, RL_TEXTURE_FILTER_NEAREST);
+
+		pages.push_back(texture);
+	}
+
+	// The pixels are only needed to build the pages
+	for (auto& entry : entries) {
+		UnloadImage(entry.image);
+		entry.image = {};
+	}
+}
+
+void Atlas::unload() {
+	if ( Renderer::has_gpu() ) for (auto& page : pages) UnloadTexture(page);
+	pages.clear();
+}
+
+void Atlas::draw(AtlasImage image, Rectangle dest, Vector2 origin, float rotation, Color tint) {
+	const Entry& entry = entries[image];
+	if (entry.page < 0) return;
+
+	Renderer::texture(pages[entry.page], entry.rect, dest, origin, rotation, tint);
+}
+
+void Atlas::draw(AtlasImage image, Vector2 position, Color tint) {
+	const Entry& entry = entries[image];
+	draw( image, { position.x, position.y, entry.rect.width, entry.rect.height }, { 0, 0 }, 0.0, tint );
+}
+
+void Atlas::queue(AtlasImage image, Rectangle dest, Vector2 origin, float rotation, Color tint) {
+	const Entry& entry = entries[image];
+	if (entry.page < 0) return;
+
+	RenderQueue::texture(pages[entry.page], entry.rect, dest, origin, rotation, tint);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <raylib-cpp.hpp>
+
+typedef int AtlasImage; // Index of an image added to the atlas
+
+// Packs sprites and UI images into a few large textures, so drawing them doesn't break the batch
+class Atlas {
+private:
+	static const int page_size = 4096;
+	static const int padding = 4; // Space around each image, mipmaps stay clean down to a quarter size
+
+	struct Entry {
+		Image image; // Pixels waiting to be packed
+		int page = -1;
+		Rectangle rect = {}; // Where the image is on its page
+	};
+
+	inline static std::vector<Entry> entries;
+	inline static std::vector<Texture2D> pages;
+
+	static int pack(); // Places the entries on shelves, returns the number of pages
+
+public:
+	static AtlasImage add(const Image& image, Rectangle source); // Copies part of an image to be packed
+	static AtlasImage add(const std::string filename); // Adds a whole image file
+	static void build(); // Uploads the pages with mipmaps, call after everything is added
+	static void unload();
+
+	static void draw(AtlasImage image, Rectangle dest, Vector2 origin = {0, 0}, float rotation = 0.0, Color tint = WHITE);
+	static void draw(AtlasImage image, Vector2 position, Color tint = WHITE); // Draws at full size
+	static void queue(AtlasImage image, Rectangle dest, Vector2 origin, float rotation, Color tint); // Draws through the render queue
+	Atlas() = delete;
+};
@@ -18,6 +18,7 @@ void play_sound(std::string name, float volume, float pitch) {
 }
 
 void play_music() {
+	if ( !IsAudioDeviceReady() ) return; // Headless runs have no audio
 	float volume = ease(game_time / 3.0, 0.0, 1.0); // Fade in music at start
 	volume = Clamp(volume, 0.0, 1.0);
 	music.SetVolume(volume);
@@ -25,10 +26,12 @@ void play_music() {
 }
 
 void stop_music() {
+	if ( !IsAudioDeviceReady() ) return;
 	music.Stop();
 }
 
 void set_music(const std::string filename) {
+	if ( !IsAudioDeviceReady() ) return;
 	music = raylib::Music(filename);
 	music.Play();
 	music.SetLooping(true);
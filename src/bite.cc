@@ -60,7 +60,7 @@ void Bite::update() {
 	if (!active) return;
 	if (!has_target) return;
 
-	timer -= GetFrameTime(); // Count down the timer
+	timer -= tick_length; // Count down the timer
 	if (timer > 0.0) return;
 
 	auto owner_health = registry.try_get<Health>(owner);
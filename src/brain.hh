@@ -4,6 +4,7 @@
 #include <raylib-cpp.hpp>
 
 #include "typedefs.hh"
+#include "tilemap.hh"
 
 class Brain {
 protected:
@@ -30,9 +31,14 @@ public:
 class GuardBrain : public Brain {
 private:
 	Vector2 find_player();
+	bool can_see(const TileCoord from, const TileCoord to); // Cached line of sight check
 	float aggro_range = 700.0;
 	float attack_range = 400.0;
 
+	// Last line of sight result and the tiles it was traced between
+	TileCoord sight_from = {-1, -1}, sight_to = {-1, -1};
+	bool sight = false;
+
 public:
 	void think();
 
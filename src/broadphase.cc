@@ -0,0 +1,82 @@
+#include <cmath>
+#include <algorithm>
+#include <raylib-cpp.hpp>
+
+#include "globals.hh"
+#include "components.hh"
+#include "broadphase.hh"
+
+const int tiles_per_cell = 4; // Cell size in tiles
+
+int Broadphase::cell_x(float x) {
+	int c = floor(x / cell_size);
+	return std::clamp(c, 0, columns - 1); // Things outside the map go in the edge cells
+}
+
+int Broadphase::cell_y(float y) {
+	int c = floor(y / cell_size);
+	return std::clamp(c, 0, rows - 1);
+}
+
+void Broadphase::insert(const Entry& entry) {
+	const size_t index = entries.size();
+	entries.push_back(entry);
+	stamps.push_back(0);
+
+	const int start_x = cell_x(entry.rect.x);
+	const int end_x = cell_x(entry.rect.x + entry.rect.width);
+	const int start_y = cell_y(entry.rect.y);
+	const int end_y = cell_y(entry.rect.y + entry.rect.height);
+
+	for (int y = start_y; y <= end_y; y++)
+	for (int x = start_x; x <= end_x; x++) {
+		cells[y * columns + x].push_back(index);
+	}
+}
+
+void Broadphase::update() {
+	cell_size = tilemap.tile_size * tiles_per_cell;
+	columns = std::max( 1, int( ceil( float(tilemap.width * tilemap.tile_size) / cell_size ) ) );
+	rows = std::max( 1, int( ceil( float(tilemap.height * tilemap.tile_size) / cell_size ) ) );
+
+	// Clear the grid but keep the memory between frames
+	cells.resize(columns * rows);
+	for (auto& cell : cells) cell.clear();
+	entries.clear();
+	stamps.clear();
+	query_count = 0;
+
+	auto view = registry.view<const Position, const Collider>();
+	for ( auto [entity, position, collider] : view.each() ) {
+		if (!collider.enabled) continue; // Disabled colliders can't be touched
+
+		insert( { entity, collider.get_rectangle(position.value) } );
+	}
+}
+
+void Broadphase::query(const raylib::Rectangle& area, std::vector<entt::entity>& found) {
+	if ( cells.empty() ) return;
+	query_count++; // Each entry is only reported once per query
+
+	const int start_x = cell_x(area.x);
+	const int end_x = cell_x(area.x + area.width);
+	const int start_y = cell_y(area.y);
+	const int end_y = cell_y(area.y + area.height);
+
+	for (int y = start_y; y <= end_y; y++)
+	for (int x = start_x; x <= end_x; x++)
+	for ( auto index : cells[y * columns + x] ) {
+		if (stamps[index] == query_count) continue; // Already checked from another cell
+		stamps[index] = query_count;
+
+		if ( entries[index].rect.CheckCollision(area) ) found.push_back(entries[index].entity);
+	}
+}
+
+void Broadphase::query(const vec2 point, std::vector<entt::entity>& found) {
+	if ( cells.empty() ) return;
+
+	for ( auto index : cells[ cell_y(point.y) * columns + cell_x(point.x) ] ) {
+		if ( entries[index].rect.CheckCollision(point) ) found.push_back(entries[index].entity);
+	}
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <entt/entt.hpp>
+#include <raylib-cpp.hpp>
+
+#include "typedefs.hh"
+
+// Uniform grid of collider bounds used to find nearby entities without scanning the registry
+class Broadphase {
+private:
+	struct Entry {
+		entt::entity entity;
+		raylib::Rectangle rect;
+	};
+
+	inline static std::vector<Entry> entries;
+	inline static std::vector< std::vector<size_t> > cells; // Indices into entries
+	inline static std::vector<unsigned int> stamps; // Last query that visited each entry
+	inline static unsigned int query_count = 0;
+	inline static int columns = 0, rows = 0;
+	inline static float cell_size = 128.0;
+
+	static int cell_x(float x);
+	static int cell_y(float y);
+	static void insert(const Entry& entry);
+
+public:
+	static void update(); // Rebuilds the grid from all enabled colliders
+	static void query(const raylib::Rectangle& area, std::vector<entt::entity>& found); // Colliders overlapping a rectangle, writes the stamps so one caller at a time
+	static void query(const vec2 point, std::vector<entt::entity>& found); // Colliders containing a point
+	Broadphase() = delete;
+};
@@ -0,0 +1,145 @@
+#include <cmath>
+#include <vector>
+#include <raylib-cpp.hpp>
+
+#include "globals.hh"
+#include "components.hh"
+#include "systems.hh"
+#include "bullet.hh"
+#include "broadphase.hh"
+#include "util.hh"
+#include "collision.hh"
+#include "render_queue.hh"
+#include "camera.hh"
+
+void BulletPool::spawn(vec2 position, vec2 velocity, int damage, entt::entity owner, Sprite* sprite) {
+	if (count == capacity) return; // Drop bullets when the pool is full
+
+	x[count] = position.x;
+	y[count] = position.y;
+	previous_x[count] = position.x;
+	previous_y[count] = position.y;
+	vx[count] = velocity.x;
+	vy[count] = velocity.y;
+	BulletPool::damage[count] = damage;
+	BulletPool::owner[count] = owner;
+	BulletPool::sprite[count] = sprite;
+	dead[count] = false;
+	count++;
+}
+
+void BulletPool::block(const raylib::Rectangle& area, float origin_x, bool deflect, entt::entity deflector) {
+	for (size_t i = 0; i < count; i++) {
+		if ( dead[i] ) continue;
+		if ( !CheckCollisionPointRec( {x[i], y[i]}, area ) ) continue;
+
+		// Destroy the bullet if it can't be deflected
+		if (!deflect) {
+			dead[i] = true;
+			continue;
+		}
+
+		// Reverse bullets travelling towards the origin, they can hit whoever fired them now
+		if ( sign(vx[i]) == sign(origin_x - x[i]) ) {
+			vx[i] *= -1;
+			owner[i] = deflector;
+		}
+	}
+
+	compact();
+}
+
+void BulletPool::integrate() {
+	for (size_t i = 0; i < count; i++) {
+		previous_x[i] = x[i];
+		previous_y[i] = y[i];
+		x[i] += vx[i];
+		y[i] += vy[i];
+	}
+}
+
+void BulletPool::tile_hits() {
+	for (size_t i = 0; i < count; i++) {
+		// A bullet already inside a wall won't hit its edge
+		if ( tilemap.solid_point(x[i], y[i]) ) {
+			dead[i] = true;
+			continue;
+		}
+
+		// Sweep the whole path so fast bullets can't pass through thin walls
+		SweepHit hit = sweep_box( raylib::Rectangle(x[i], y[i], 0.0, 0.0), vec2(vx[i], vy[i]) );
+
+		// Destroy bullets that hit a wall or leave the map
+		TileCoord tile = tilemap.world_to_tile( x[i] + vx[i], y[i] + vy[i] );
+		dead[i] = hit.hit || !tilemap.tile_in_map(tile);
+	}
+}
+
+void BulletPool::collider_hits() {
+	std::vector<entt::entity> candidates;
+
+	for (size_t i = 0; i < count; i++) {
+		if ( dead[i] ) continue;
+
+		candidates.clear();
+		Broadphase::query( vec2(x[i], y[i]), candidates );
+
+		for ( auto target : candidates ) {
+			if (target == owner[i]) continue; // Don't shoot self
+			if ( !registry.all_of<Health>(target) ) continue;
+
+			deal_damage( target, damage[i], vec2(vx[i], vy[i]) );
+			dead[i] = true;
+			break; // Stop looping over targets
+		}
+	}
+}
+
+void BulletPool::compact() {
+	size_t alive = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		if ( dead[i] ) continue;
+
+		x[alive] = x[i];
+		y[alive] = y[i];
+		previous_x[alive] = previous_x[i];
+		previous_y[alive] = previous_y[i];
+		vx[alive] = vx[i];
+		vy[alive] = vy[i];
+		damage[alive] = damage[i];
+		owner[alive] = owner[i];
+		sprite[alive] = sprite[i];
+		dead[alive] = false;
+		alive++;
+	}
+
+	count = alive;
+}
+
+void BulletPool::update() {
+	tile_hits();
+	integrate();
+	collider_hits();
+	compact();
+}
+
+void BulletPool::draw() {
+	for (size_t i = 0; i < count; i++) {
+		float rotation = atan2(vy[i], vx[i]) * (180/PI);
+		vec2 location(x[i], y[i]);
+
+		if ( !CameraSystem::in_view( location, sprite[i] ? sprite[i]->radius() : 4.0f ) ) continue;
+
+		// Render the bullet sprite, drawn between this step and the last
+		RenderQueue::set_motion( {previous_x[i] - x[i], previous_y[i] - y[i]} );
+		if ( sprite[i] )
+			sprite[i]->render(location, IDLE, 0.0, +1, rotation);
+		else
+			RenderQueue::circle(location, 4, ORANGE);
+	}
+}
+
+void BulletPool::clear() {
+	count = 0;
+}
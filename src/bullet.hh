@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <entt/entt.hpp>
+#include <raylib-cpp.hpp>
+
+#include "typedefs.hh"
+#include "sprite.hh"
+
+// Fixed size pool of bullets stored as parallel arrays
+class BulletPool {
+private:
+	static const size_t capacity = 4096;
+
+	inline static std::array<float, capacity> x, y;
+	inline static std::array<float, capacity> previous_x, previous_y; // Position at the start of the step
+	inline static std::array<float, capacity> vx, vy;
+	inline static std::array<int, capacity> damage;
+	inline static std::array<entt::entity, capacity> owner;
+	inline static std::array<Sprite*, capacity> sprite;
+	inline static std::array<bool, capacity> dead;
+	inline static size_t count = 0;
+
+	static void integrate();
+	static void tile_hits();
+	static void collider_hits();
+	static void compact(); // Removes dead bullets
+
+public:
+	static void spawn(vec2 position, vec2 velocity, int damage, entt::entity owner, Sprite* sprite);
+	static void block(const raylib::Rectangle& area, float origin_x, bool deflect, entt::entity deflector); // Destroys or turns back bullets in an area, turned bullets belong to the deflector
+	static void update();
+	static void draw();
+	static void clear();
+	BulletPool() = delete;
+};
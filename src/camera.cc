@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 #include <raylib-cpp.hpp>
 
 #include "globals.hh"
@@ -7,6 +8,7 @@
 #include "systems.hh"
 #include "camera.hh"
 #include "util.hh"
+#include "viewport.hh"
 
 void camera_update() {
 	float map_width = tilemap.width * tilemap.tile_size;
@@ -27,8 +29,8 @@ void camera_update() {
 		vec2 look_ahead(96.0, 32.0);
 		vec2 target = position.value + (velocity.value * look_ahead); // Look ahead
 
-		camera.target.x += (target.x - camera.target.x) * sx * GetFrameTime();
-		camera.target.y += (target.y - camera.target.y) * sy * GetFrameTime();
+		camera.target.x += (target.x - camera.target.x) * sx * tick_length;
+		camera.target.y += (target.y - camera.target.y) * sy * tick_length;
 
 		// Restrict camera to map
 		if (camera.target.x < camera.offset.x) camera.target.x = camera.offset.x; // Left edge
@@ -39,6 +41,7 @@ void camera_update() {
 }
 
 vec2 CameraSystem::find_player() {
+	if ( !registry.valid(player) ) return base; // Stay put without a player
 	return registry.get<Position>(player).value;
 }
 
@@ -47,6 +50,7 @@ vec2 CameraSystem::track_player() {
 }
 
 vec2 CameraSystem::look_ahead() {
+	if ( !registry.valid(player) ) return vec2(0.0, 0.0);
 	auto velocity = registry.get<Velocity>(player).value;
 
 	vec2 scale;
@@ -111,8 +115,8 @@ void CameraSystem::shake() {
 	offset.x += pow(trauma, 2) * ((float)rand() / (float)RAND_MAX - 0.5) * shake_scale;
 	offset.y += pow(trauma, 2) * ((float)rand() / (float)RAND_MAX - 0.5) * shake_scale;
 
-	trauma -= 1.0 * GetFrameTime();
-	offset *= 0.9 * GetFrameTime();
+	trauma -= 1.0 * tick_length;
+	offset *= 0.9 * tick_length;
 }
 
 void CameraSystem::clamp_camera() {
@@ -138,11 +142,22 @@ void CameraSystem::init() {
 	close_distance = 1200.0;
 
 	camera = raylib::Camera2D( vec2(screen_width/2, screen_height/2), {0.0, 0.0} );
+	base = vec2(0.0, 0.0);
 	base = find_player();
 	offset = vec2(0, 0);
+
+	camera.target = base;
+	clamp_camera();
+	previous_target = camera.target;
+	previous_zoom = zoom;
+	view = camera;
+	update_culling_area();
 }
 
 void CameraSystem::update() {
+	previous_target = camera.target;
+	previous_zoom = camera.zoom;
+
 	const auto characters = find_close_characters();
 
 	vec2 delta =
@@ -151,16 +166,65 @@ void CameraSystem::update() {
 		center_close_characters(characters) * 0.6;
 	float delta_zoom = zoom_to_characters(characters);
 
-	base += delta * GetFrameTime();
-	zoom += delta_zoom * GetFrameTime();
+	base += delta * tick_length;
+	zoom += delta_zoom * tick_length;
 
 	shake();
 
 	camera.target = base + offset;
 	camera.zoom = zoom;
 	clamp_camera();
+	update_culling_area();
+}
+
+void CameraSystem::update_culling_area() {
+	// Frames are drawn anywhere between the last step and this one, so cull against both views
+	const float z = 1.0 / camera.zoom;
+	const float previous_z = 1.0 / previous_zoom;
+
+	const float left = std::min( camera.target.x - camera.offset.x * z, previous_target.x - camera.offset.x * previous_z );
+	const float top = std::min( camera.target.y - camera.offset.y * z, previous_target.y - camera.offset.y * previous_z );
+	const float right = std::max( camera.target.x + (screen_width - camera.offset.x) * z, previous_target.x + (screen_width - camera.offset.x) * previous_z );
+	const float bottom = std::max( camera.target.y + (screen_height - camera.offset.y) * z, previous_target.y + (screen_height - camera.offset.y) * previous_z );
+
+	culling_area = raylib::Rectangle(left, top, right - left, bottom - top);
+}
+
+CameraState CameraSystem::get_state() {
+	return { camera, previous_target, previous_zoom };
+}
+
+void CameraSystem::interpolate(const CameraState& state, float alpha) {
+	view = state.camera;
+	view.target = state.previous_target + (vec2(state.camera.target) - state.previous_target) * alpha;
+	view.zoom = state.previous_zoom + (state.camera.zoom - state.previous_zoom) * alpha;
+
+	// Same part of the world at the viewport's resolution
+	const float scale = Viewport::get_scale();
+	view.offset = vec2(view.offset) * scale;
+	view.zoom *= scale;
+}
+
+bool CameraSystem::in_view(vec2 position, float margin) {
+	return position.x >= culling_area.x - margin && position.x <= culling_area.x + culling_area.width + margin
+		&& position.y >= culling_area.y - margin && position.y <= culling_area.y + culling_area.height + margin;
+}
+
+bool CameraSystem::in_view(const Rectangle& area) {
+	return culling_area.CheckCollision(area);
+}
+
+raylib::Rectangle CameraSystem::get_view_area() {
+	const float z = 1.0 / camera.zoom;
+
+	return raylib::Rectangle(
+		camera.target.x - camera.offset.x * z,
+		camera.target.y - camera.offset.y * z,
+		screen_width * z,
+		screen_height * z
+	);
 }
 
 raylib::Camera2D& CameraSystem::get_camera() {
-	return camera;
+	return view;
 }
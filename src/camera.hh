@@ -5,12 +5,23 @@
 
 #include "typedefs.hh"
 
+// The camera after a step and where it was before, so frames can be drawn between the two
+struct CameraState {
+	raylib::Camera2D camera;
+	vec2 previous_target;
+	float previous_zoom;
+};
+
 class CameraSystem {
 private:
 	inline static raylib::Camera2D camera;
+	inline static raylib::Camera2D view; // Camera interpolated between steps
+	inline static vec2 previous_target;
+	inline static float previous_zoom;
 	inline static float zoom, min_zoom, max_zoom;
 	inline static float close_distance;
 	inline static vec2 base, offset;
+	inline static raylib::Rectangle culling_area; // World area seen at some point between the last two steps
 
 	static vec2 find_player();
 	static vec2 track_player();
@@ -20,12 +31,18 @@ private:
 	static float zoom_to_characters(const std::vector< vec2 >& characters);
 	static void shake();
 	static void clamp_camera();
+	static void update_culling_area();
 
 public:
 	inline static float trauma = 0.0;
 
 	static void init();
 	static void update();
+	static CameraState get_state(); // Copied into render snapshots
+	static void interpolate(const CameraState& state, float alpha); // Moves the view between the last two steps, scaled to the viewport
 	static raylib::Camera2D& get_camera();
+	static raylib::Rectangle get_view_area(); // World area seen by the camera after the last step
+	static bool in_view(vec2 position, float margin); // True if a point is within a margin of the view between the last two steps
+	static bool in_view(const Rectangle& area); // True if an area overlaps the view between the last two steps
 	CameraSystem() = delete;
 };
@@ -7,9 +7,10 @@
 #include "util.hh"
 #include "audio.hh"
 #include "controls.hh"
+#include "jobs.hh"
 
 void character_think() {
-	for ( auto [entity, character] : registry.view<const Character>().each() ) {
+	for ( auto [entity, character] : registry.view<const Character>(entt::exclude<Dormant>).each() ) {
 		if (character.active == false) continue;
 		if (character.brain == nullptr) continue;
 
@@ -19,7 +20,7 @@ void character_think() {
 
 void stun() {
 	for ( auto [entity, character, stun] : registry.view<Character, Stun>().each() ) {
-		stun.timer -= GetFrameTime();
+		stun.timer -= tick_length;
 		character.active = stun.timer > 0.0? false : true;
 
 		if (stun.timer <= 0.0) registry.remove<Stun>(entity);
@@ -27,9 +28,12 @@ void stun() {
 }
 
 void death_by_pitfall() {
-	for ( auto [entity, character, position, health, collider] : registry.view<Character, Position, Health, Collider>().each() ) {
+	auto view = registry.view<const Character, const Position, Health, const Collider>(entt::exclude<Dormant>);
+	parallel_each(view, [&](entt::entity entity) {
+		auto [position, health, collider] = view.get<const Position, Health, const Collider>(entity);
+
 		// Check if the character's whole collider has fallen out of the map
 		if (position.value.y > tilemap.height * tilemap.tile_size + collider.height )
 			health.now = 0;
-	}
+	});
 }
@@ -0,0 +1,120 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <raylib-cpp.hpp>
+
+#include "globals.hh"
+#include "collision.hh"
+#include "util.hh"
+
+const float e = 0.1; // Ensures tiles that are only touched aren't counted
+
+// Finds the range of tiles covered by a span on one axis
+static void tile_span(float start, float length, int& first, int& last) {
+	first = floor( start / tilemap.tile_size );
+	last = floor( (start + length - e) / tilemap.tile_size );
+	last = std::max(first, last);
+}
+
+// Walks the tile boundaries crossed by the leading edges of the box in order of time
+SweepHit sweep_box(const raylib::Rectangle& box, const vec2 motion) {
+	SweepHit result;
+	const float size = tilemap.tile_size;
+	const float never = std::numeric_limits<float>::infinity();
+
+	const int step_x = sign(motion.x);
+	const int step_y = sign(motion.y);
+
+	const float lead_x = step_x > 0? box.x + box.width : box.x;
+	const float lead_y = step_y > 0? box.y + box.height : box.y;
+
+	// Next column and row the leading edges enter
+	int column = step_x > 0? ceil( (lead_x - e) / size ) : floor( (lead_x + e) / size ) - 1;
+	int row = step_y > 0? ceil( (lead_y - e) / size ) : floor( (lead_y + e) / size ) - 1;
+
+	// Time each boundary is crossed
+	float next_x = never, next_y = never;
+	float delta_x = never, delta_y = never;
+
+	if (step_x != 0) {
+		float boundary = (step_x > 0? column : column + 1) * size;
+		next_x = std::max( 0.0f, (boundary - lead_x) / motion.x );
+		delta_x = size / std::abs(motion.x);
+	}
+
+	if (step_y != 0) {
+		float boundary = (step_y > 0? row : row + 1) * size;
+		next_y = std::max( 0.0f, (boundary - lead_y) / motion.y );
+		delta_y = size / std::abs(motion.y);
+	}
+
+	while ( std::min(next_x, next_y) <= 1.0 ) {
+		int first, last;
+
+		if (next_x < next_y) {
+			// Check the column being entered over the height of the box at that time
+			tile_span(box.y + motion.y * next_x, box.height, first, last);
+
+			if ( tilemap.solid_box(column, first, column, last) ) {
+				result.hit = true;
+				result.time = next_x;
+				result.normal = vec2(-step_x, 0);
+				return result;
+			}
+
+			column += step_x;
+			next_x += delta_x;
+		} else {
+			// Check the row being entered over the width of the box at that time
+			tile_span(box.x + motion.x * next_y, box.width, first, last);
+
+			if ( tilemap.solid_span(first, last, row) ) {
+				result.hit = true;
+				result.time = next_y;
+				result.normal = vec2(0, -step_y);
+				return result;
+			}
+
+			row += step_y;
+			next_y += delta_y;
+		}
+	}
+
+	return result;
+}
+
+SweepHit ray_box(const vec2 start, const vec2 motion, const raylib::Rectangle& box) {
+	SweepHit result;
+	float enter = 0.0, exit = 1.0;
+
+	// Clip the motion against the slab of each axis
+	const float starts[2] = { start.x, start.y };
+	const float motions[2] = { motion.x, motion.y };
+	const float mins[2] = { box.x, box.y };
+	const float maxs[2] = { box.x + box.width, box.y + box.height };
+	vec2 normal;
+
+	for (int axis = 0; axis < 2; axis++) {
+		if (motions[axis] == 0.0) {
+			if ( starts[axis] < mins[axis] || starts[axis] > maxs[axis] ) return result; // Parallel and outside
+			continue;
+		}
+
+		float t0 = (mins[axis] - starts[axis]) / motions[axis];
+		float t1 = (maxs[axis] - starts[axis]) / motions[axis];
+		if (t0 > t1) std::swap(t0, t1);
+
+		if (t0 > enter) {
+			enter = t0;
+			normal = axis == 0? vec2(-sign(motions[axis]), 0) : vec2(0, -sign(motions[axis]));
+		}
+		exit = std::min(exit, t1);
+
+		if (enter > exit) return result;
+	}
+
+	result.hit = true;
+	result.time = enter;
+	result.normal = normal;
+	return result;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <raylib-cpp.hpp>
+
+#include "typedefs.hh"
+
+struct SweepHit {
+	bool hit = false;
+	float time = 1.0; // Fraction of the motion completed before the hit
+	vec2 normal; // Direction pointing out of the tile that was hit
+};
+
+SweepHit sweep_box(const raylib::Rectangle& box, const vec2 motion); // Finds the first solid tile a moving box touches
+SweepHit ray_box(const vec2 start, const vec2 motion, const raylib::Rectangle& box); // Finds where a moving point enters a rectangle
@@ -9,6 +9,7 @@
 #include "audio.hh"
 #include "camera.hh"
 #include "util.hh"
+#include "bullet.hh"
 
 void deal_damage(entt::entity target, int damage, vec2 direction) {
 	// Check if target as a health component
@@ -17,6 +18,8 @@ void deal_damage(entt::entity target, int damage, vec2 direction) {
 	auto& health = registry.get<Health>(target); // Deal damage
 	health.now -= damage;
 
+	registry.remove<Dormant, Asleep>(target); // Wake up targets that get hit
+
 	// Check if they have a position and collider
 	if ( !registry.all_of<Position, Collider>(target) ) return;
 
@@ -27,7 +30,7 @@ void deal_damage(entt::entity target, int damage, vec2 direction) {
 	CameraSystem::trauma += float(damage) / 100.0;
 
 	// Spawn blood spray if they do
-	ParticleSystem blood_system;
+	ParticleEmitter blood_system;
 	blood_system.count = damage;
 	blood_system.speed_start = 800.0;
 	blood_system.speed_end = 500.0;
@@ -43,10 +46,7 @@ void deal_damage(entt::entity target, int damage, vec2 direction) {
 	blood_system.gravity_scale = 100.0;
 	blood_system.collision = true;
 	blood_system.sprite = &sprite_list["blood"];
-	blood_system.start();
-
-	const auto blood_entity = registry.create();
-	registry.emplace<ParticleSystem>(blood_entity, blood_system);
+	ParticlePool::emit(blood_system);
 }
 
 void death() {
@@ -72,7 +72,7 @@ void death() {
 }
 
 void weapon_update() {
-	auto view = registry.view<WeaponSet>();
+	auto view = registry.view<WeaponSet>(entt::exclude<Dormant>);
 
 	for ( auto [entity, weapon_set] : view.each() ) {
 		for (auto& weapon : weapon_set) weapon->update();
@@ -80,30 +80,6 @@ void weapon_update() {
 }
 
 void bullets() {
-	auto view = registry.view<Position, const Velocity, const Bullet>();
-	for ( auto [entity, position, velocity, bullet] : view.each() ) {
-		position.value += velocity.value;
-
-		// Check for tile collision or map exit
-		TileCoord tile = tilemap.world_to_tile(position.value);
-		if ( tilemap(tile) != empty_tile ) {
-			registry.destroy(entity); // Destroy the bullet
-			continue;
-		}
-
-		// Collider collisions
-		auto target_view = registry.view<const Position, const Collider, Health>();
-		for ( auto [target, target_position, target_collider, target_health] : target_view.each() ) {
-			// Check if the bullet is in a collider
-			if ( !target_collider.get_rectangle(target_position.value).CheckCollision(position.value) )
-				continue;
-
-			if ( !target_collider.enabled ) continue; // Skip disabled colliders
-
-			deal_damage(target, bullet.damage, velocity.value);
-			registry.destroy(entity); // Destroy the bullet
-			break; // Stop looping over targets
-		}
-
-	}
+	BulletPool::update();
+	Gun::update_tracers();
 }
@@ -59,6 +59,11 @@ struct Gravity { // Makes an object affected by gravity
 
 struct Position {
 	vec2 value;
+	vec2 previous; // Value at the start of the step
+
+	vec2 lerp(float alpha) const {
+		return previous + (value - previous) * alpha;
+	}
 
 	void from_toml(const toml::value& v);
 };
@@ -142,15 +147,14 @@ struct RayCast {
 	void from_toml(const toml::value& v);
 };
 
-struct Bullet {
-	int damage;
-	Sprite* sprite = nullptr;
-};
-
 struct Stun {
 	float timer;
 };
 
+struct Dormant {}; // Tags entities too far from the camera to simulate
+
+struct Asleep {}; // Tags bodies resting on the floor that physics can skip
+
 struct Jump {
 	float speed;
 	float gravity_scale;
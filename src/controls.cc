@@ -1,5 +1,6 @@
 #include <string>
 #include <iostream>
+#include <atomic>
 #include <raylib.h>
 #include <toml.hpp>
 
@@ -14,6 +15,17 @@ int input_map[COMMAND_COUNT][2];
 const int KEYBOARD = 0;
 const int CONTROLLER = 1;
 
+// Presses and releases since the last simulation step
+// Polled by the main thread, taken by the simulation before each step
+std::atomic<bool> polled_down[COMMAND_COUNT];
+std::atomic<bool> polled_pressed[COMMAND_COUNT];
+std::atomic<bool> polled_released[COMMAND_COUNT];
+
+// What the current step sees
+bool down[COMMAND_COUNT];
+bool pressed[COMMAND_COUNT];
+bool released[COMMAND_COUNT];
+
 void load_control_config() {
 	std::cout << "Loading config.cfg" << '\n';
 	const auto data = toml::parse("config.cfg");
@@ -50,16 +62,41 @@ void load_control_config() {
 }
 
 bool command_down(const Command command) {
-	return IsKeyDown( input_map[command][KEYBOARD] ) ||
-		IsGamepadButtonDown( 0, input_map[command][CONTROLLER] );
+	return down[command];
 }
 
 bool command_pressed(const Command command) {
-	return IsKeyPressed( input_map[command][KEYBOARD] ) ||
-		IsGamepadButtonPressed( 0, input_map[command][CONTROLLER] );
+	return pressed[command];
 }
 
 bool command_released(const Command command) {
-	return IsKeyReleased( input_map[command][KEYBOARD] ) ||
-		IsGamepadButtonReleased( 0, input_map[command][CONTROLLER] );
+	return released[command];
+}
+
+void poll_commands() {
+	for (int command = COMMAND_NONE + 1; command < COMMAND_COUNT; command++) {
+		polled_down[command] = IsKeyDown( input_map[command][KEYBOARD] ) ||
+			IsGamepadButtonDown( 0, input_map[command][CONTROLLER] );
+
+		if ( IsKeyPressed( input_map[command][KEYBOARD] ) || IsGamepadButtonPressed( 0, input_map[command][CONTROLLER] ) )
+			polled_pressed[command] = true;
+
+		if ( IsKeyReleased( input_map[command][KEYBOARD] ) || IsGamepadButtonReleased( 0, input_map[command][CONTROLLER] ) )
+			polled_released[command] = true;
+	}
+}
+
+void take_commands() {
+	for (int command = COMMAND_NONE + 1; command < COMMAND_COUNT; command++) {
+		down[command] = polled_down[command];
+		pressed[command] = polled_pressed[command].exchange(false);
+		released[command] = polled_released[command].exchange(false);
+	}
+}
+
+void clear_commands() {
+	for (int command = 0; command < COMMAND_COUNT; command++) {
+		pressed[command] = false;
+		released[command] = false;
+	}
 }
@@ -18,6 +18,9 @@ enum Command {
 };
 
 void load_control_config();
+void poll_commands(); // Stores presses and releases until the next simulation step, on the main thread
+void take_commands(); // Gives the step the commands polled since the last one, on the simulation thread
+void clear_commands();
 
 bool command_down(const Command command);
 bool command_pressed(const Command command);
@@ -0,0 +1,148 @@
+#include <cmath>
+#include <algorithm>
+#include <raylib-cpp.hpp>
+
+#include "decals.hh"
+#include "tilemap.hh"
+#include "camera.hh"
+#include "viewport.hh"
+#include "renderer.hh"
+
+void Decals::init(int width, int height, int tile_size) {
+	clear();
+
+	chunks_x = (width + chunk_size - 1) / chunk_size;
+	chunks_y = (height + chunk_size - 1) / chunk_size;
+	chunk_pixels = chunk_size * tile_size;
+	chunks.resize(chunks_x * chunks_y);
+}
+
+void Decals::clear() {
+	unload();
+	chunks.clear();
+	chunks_x = 0;
+	chunks_y = 0;
+
+	// Decals from the last level are dropped
+	std::lock_guard<std::mutex> lock(pending_lock);
+	pending.clear();
+}
+
+void Decals::stamp(Vector2 position, float radius, Color color) {
+	std::lock_guard<std::mutex> lock(pending_lock);
+	pending.push_back( { position, radius, color } );
+}
+
+void Decals::add(const Decal& decal) {
+	const int start_x = std::max( (int)floor( (decal.position.x - decal.radius) / chunk_pixels ), 0 );
+	const int start_y = std::max( (int)floor( (decal.position.y - decal.radius) / chunk_pixels ), 0 );
+	const int end_x = std::min( (int)floor( (decal.position.x + decal.radius) / chunk_pixels ), chunks_x - 1 );
+	const int end_y = std::min( (int)floor( (decal.position.y + decal.radius) / chunk_pixels ), chunks_y - 1 );
+
+	for (int y = start_y; y <= end_y; y++)
+	for (int x = start_x; x <= end_x; x++) {
+		Chunk& chunk = chunks[y * chunks_x + x];
+		if ( (int)chunk.decals.size() < max_decals ) chunk.decals.push_back(decal);
+	}
+}
+
+void Decals::visible_chunks(int& start_x, int& start_y, int& end_x, int& end_y) {
+	const Camera2D& camera = CameraSystem::get_camera();
+	const Vector2 min_corner = GetScreenToWorld2D( {0.0, 0.0}, camera );
+	const Vector2 max_corner = GetScreenToWorld2D( {(float)Viewport::get_width(), (float)Viewport::get_height()}, camera );
+
+	start_x = std::max( (int)floor(min_corner.x / chunk_pixels), 0 );
+	start_y = std::max( (int)floor(min_corner.y / chunk_pixels), 0 );
+	end_x = std::min( (int)floor(max_corner.x / chunk_pixels), chunks_x - 1 );
+	end_y = std::min( (int)floor(max_corner.y / chunk_pixels), chunks_y - 1 );
+}
+
+void Decals::bake(Chunk& chunk, int chunk_x, int chunk_y) {
+	const bool fresh = chunk.target.id == 0;
+	if (fresh) {
+		chunk.target = LoadRenderTexture(chunk_pixels, chunk_pixels);
+		chunk.baked = 0;
+	}
+
+	// Only decals added since the last bake are drawn, the rest are already there
+	const Vector2 origin = { chunk_x * chunk_pixels, chunk_y * chunk_pixels };
+
+	BeginTextureMode(chunk.target);
+	if (fresh) ClearBackground(BLANK);
+
+	for (size_t i = chunk.baked; i < chunk.decals.size(); i++) {
+		const Decal& decal = chunk.decals[i];
+		DrawCircleV( { decal.position.x - origin.x, decal.position.y - origin.y }, decal.radius, decal.color );
+	}
+
+	EndTextureMode();
+	chunk.baked = chunk.decals.size();
+}
+
+void Decals::prepare() {
+	frame++;
+
+	{
+		std::lock_guard<std::mutex> lock(pending_lock);
+		for (const auto& decal : pending) add(decal);
+		pending.clear();
+	}
+
+	if ( chunks.empty() ) return;
+
+	int start_x, start_y, end_x, end_y;
+	visible_chunks(start_x, start_y, end_x, end_y);
+
+	for (int y = start_y; y <= end_y; y++)
+	for (int x = start_x; x <= end_x; x++) {
+		Chunk& chunk = chunks[y * chunks_x + x];
+		if ( chunk.decals.empty() ) continue;
+
+		chunk.last_seen = frame;
+		if ( !Renderer::has_gpu() ) continue; // Nothing to bake into
+		if (chunk.target.id == 0 || chunk.baked < chunk.decals.size()) bake(chunk, x, y);
+	}
+
+	// Free chunks that haven't been seen for a while, they're baked again from their decals
+	for (auto& chunk : chunks) {
+		if (chunk.target.id == 0 || frame - chunk.last_seen < chunk_lifetime) continue;
+
+		UnloadRenderTexture(chunk.target);
+		chunk.target = {};
+		chunk.baked = 0;
+	}
+}
+
+void Decals::draw() {
+	if ( chunks.empty() ) return;
+
+	int start_x, start_y, end_x, end_y;
+	visible_chunks(start_x, start_y, end_x, end_y);
+
+	for (int y = start_y; y <= end_y; y++)
+	for (int x = start_x; x <= end_x; x++) {
+		const Chunk& chunk = chunks[y * chunks_x + x];
+		if ( chunk.decals.empty() ) continue;
+
+		const Texture2D& baked = chunk.target.texture;
+		if ( baked.id == 0 && Renderer::has_gpu() ) continue; // Not baked yet, headless runs count the draw anyway
+
+		// Render textures are stored upside down
+		Renderer::texture(
+			baked,
+			{0.0, 0.0, (float)baked.width, -(float)baked.height},
+			{ x * chunk_pixels, y * chunk_pixels, chunk_pixels, chunk_pixels },
+			{0.0, 0.0},
+			0.0,
+			WHITE
+		);
+	}
+}
+
+void Decals::unload() {
+	for (auto& chunk : chunks) {
+		if (chunk.target.id != 0) UnloadRenderTexture(chunk.target);
+		chunk.target = {};
+		chunk.baked = 0;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <raylib-cpp.hpp>
+
+// A mark left on the level, like blood where a particle hit a wall
+struct Decal {
+	Vector2 position;
+	float radius;
+	Color color;
+};
+
+// Marks stamped into textures laid out like the main layer's chunks, drawn in front of it.
+// Each chunk keeps its decals so it can be baked again after it's freed off screen.
+class Decals {
+private:
+	static const int max_decals = 2048; // Per chunk, a soaked chunk doesn't change much
+	static const int chunk_lifetime = 300; // Frames a chunk stays baked off screen
+
+	struct Chunk {
+		std::vector<Decal> decals;
+		size_t baked = 0; // Decals already in the texture
+		RenderTexture2D target = {};
+		int last_seen = 0;
+	};
+
+	inline static std::vector<Chunk> chunks;
+	inline static int chunks_x = 0, chunks_y = 0;
+	inline static float chunk_pixels = 0;
+	inline static int frame = 0;
+
+	// Stamped by the simulation, taken when the next frame is prepared
+	inline static std::mutex pending_lock;
+	inline static std::vector<Decal> pending;
+
+	static void add(const Decal& decal); // Files a decal under every chunk it touches
+	static void bake(Chunk& chunk, int chunk_x, int chunk_y); // Draws the chunk's new decals into its texture
+	static void visible_chunks(int& start_x, int& start_y, int& end_x, int& end_y);
+
+public:
+	static void init(int width, int height, int tile_size); // Sizes the layer to a new level, in tiles
+	static void clear(); // Removes every decal, for when there's no level
+	static void stamp(Vector2 position, float radius, Color color); // Safe to call from the simulation
+	static void prepare(); // Bakes new and visible decals, must be called outside of drawing
+	static void draw();
+	static void unload();
+	Decals() = delete;
+};
@@ -116,7 +116,7 @@ void spawn_entity(const std::string name, const vec2 position, const int directi
 	add_component<Jump>(entity, "Jump", name);
 	add_component<AnimationState>(entity, "AnimationState", name);
 
-	registry.emplace_or_replace<Position>(entity, (Position){position});
+	registry.emplace_or_replace<Position>(entity, (Position){position, position});
 
 	add_weapons(entity, name);
 	add_brain(entity, name);
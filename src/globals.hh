@@ -5,12 +5,15 @@
 
 #include "typedefs.hh"
 #include "tilemap.hh"
+#include "atlas.hh"
 
 extern entt::registry registry;
 extern Tilemap tilemap;
 extern raylib::Camera2D camera;
 
 extern const float G; // Gravity acceleration
+extern const float tick_length; // Length of a simulation step in seconds
+extern float render_alpha; // How far the frame being drawn is between the last two steps
 
 extern int screen_width;
 extern int screen_height;
@@ -22,9 +25,9 @@ extern bool show_help;
 
 extern raylib::Font title_font;
 extern raylib::Font normal_font;
-extern raylib::Texture blood_bar;
-extern raylib::Texture intro_screen;
-extern raylib::Texture death_screen;
-extern raylib::Texture outro_screen;
+extern AtlasImage blood_bar;
+extern AtlasImage intro_screen;
+extern AtlasImage death_screen;
+extern AtlasImage outro_screen;
 
 extern float game_time; // Time since the last restart
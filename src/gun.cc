@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 #include <raylib-cpp.hpp>
 
 #include "audio.hh"
@@ -6,6 +7,13 @@
 #include "components.hh"
 #include "weapon.hh"
 #include "util.hh"
+#include "bullet.hh"
+#include "broadphase.hh"
+#include "collision.hh"
+#include "systems.hh"
+#include "render_queue.hh"
+
+const float tracer_length = 0.06; // Time a tracer stays on screen
 
 Gun::Gun(entt::entity owner, toml::value data) {
 	this->owner = owner;
@@ -14,6 +22,8 @@ Gun::Gun(entt::entity owner, toml::value data) {
 	this->spread = toml::find<float>(data, "spread");
 	this->speed = toml::find<float>(data, "speed");
 	this->rate = toml::find<float>(data, "rate");
+	this->hitscan = toml::find_or<bool>(data, "hitscan", false);
+	this->range = toml::find_or<float>(data, "range", 2000.0);
 
 	auto offset_data = toml::find< std::vector<float> >(data, "offset");
 	this->offset = vec2( offset_data[0], offset_data[1] );
@@ -27,6 +37,7 @@ void Gun::fire() {
 	auto& facing = *registry.try_get<Facing>(owner);
 
 	vec2 bullet_start = position.value + offset * vec2(facing.direction, 1.0);
+	Sprite* sprite = &sprite_list["bullet"];
 
 	// Create bullets
 	for (int i = 0; i < count; i++) {
@@ -34,20 +45,121 @@ void Gun::fire() {
 		v.x = facing.direction;
 		v.y = spread * random_spread();
 		v = v.Normalize();
-		v *= speed;
 
-		const auto bullet = registry.create();
-		registry.emplace<Position>( bullet, bullet_start );
-		registry.emplace<Velocity>( bullet, v );
-		registry.emplace<Bullet>( bullet, damage, &sprite_list["bullet"] );
+		if (hitscan) {
+			trace(bullet_start, v);
+			continue;
+		}
+
+		v *= speed;
+		BulletPool::spawn(bullet_start, v, damage, owner, sprite);
 	}
 
 	timer = rate;
 	play_sound("gun", 0.4 + random_spread() * 0.1, 1.0 + random_spread() * 0.1);
 }
 
+Shield* Gun::find_shield(vec2 start, vec2 motion, entt::entity shooter, float& time) {
+	Shield* found = nullptr;
+
+	auto view = registry.view<WeaponSet>(entt::exclude<Dormant>);
+	for ( auto [entity, weapon_set] : view.each() ) {
+		if (entity == shooter) continue; // Can't block your own shot
+
+		for ( auto weapon : weapon_set ) {
+			auto shield = dynamic_cast<Shield*>(weapon);
+			raylib::Rectangle area;
+			if ( !shield || !shield->blocking_area(area) ) continue;
+
+			SweepHit hit = ray_box(start, motion, area);
+			if ( !hit.hit || hit.time > time ) continue;
+
+			time = hit.time;
+			found = shield;
+		}
+	}
+
+	return found;
+}
+
+void Gun::trace(vec2 start, vec2 direction) {
+	const int max_deflections = 2; // Two shields facing each other can't bounce a shot forever
+	entt::entity shooter = owner;
+
+	for (int deflections = 0; deflections <= max_deflections; deflections++) {
+		vec2 motion = direction * range;
+
+		// Stop at the first wall, straight away when fired from inside one
+		float time = tilemap.solid_point(start.x, start.y) ? 0.0 : sweep_box( raylib::Rectangle(start.x, start.y, 0.0, 0.0), motion ).time;
+
+		// Find the closest target before the wall
+		std::vector<entt::entity> candidates;
+		raylib::Rectangle area(
+			std::min(start.x, start.x + motion.x * time),
+			std::min(start.y, start.y + motion.y * time),
+			std::abs(motion.x * time),
+			std::abs(motion.y * time)
+		);
+		Broadphase::query(area, candidates);
+
+		entt::entity target = entt::null;
+		for ( auto candidate : candidates ) {
+			if (candidate == shooter) continue; // The trace starts inside the shooter
+			if ( !registry.all_of<Position, Collider, Health>(candidate) ) continue;
+
+			const auto& target_position = registry.get<Position>(candidate);
+			const auto& target_collider = registry.get<Collider>(candidate);
+
+			SweepHit hit = ray_box( start, motion, target_collider.get_rectangle(target_position.value) );
+			if ( !hit.hit || hit.time > time ) continue;
+
+			time = hit.time;
+			target = candidate;
+		}
+
+		// Shields in the way block the shot like they block bullets
+		Shield* shield = find_shield(start, motion, shooter, time);
+		const vec2 end = start + motion * time;
+		tracers.push_back( {start, end, 0.0} );
+
+		if (!shield) {
+			if (target != entt::null) deal_damage(target, damage, direction * speed);
+			return;
+		}
+
+		if ( !shield->deflects() ) return;
+
+		// Reverse shots travelling towards the shield's owner, who now owns the shot
+		shooter = shield->get_owner();
+		const float origin_x = registry.get<Position>(shooter).value.x;
+		if ( sign(direction.x) == sign(origin_x - end.x) ) direction.x *= -1;
+		start = end;
+	}
+}
+
+void Gun::update_tracers() {
+	for (auto& tracer : tracers) tracer.age += tick_length;
+
+	// Remove old tracers
+	tracers.erase(
+		std::remove_if( tracers.begin(), tracers.end(), [](const Tracer& t){ return t.age > tracer_length; } ),
+		tracers.end()
+	);
+}
+
+void Gun::draw_tracers() {
+	for (const auto& tracer : tracers) {
+		float fade = 1.0 - tracer.age / tracer_length;
+		RenderQueue::line( tracer.start, tracer.end, 2.0, rgba(255, 220, 120, 255 * fade) );
+	}
+}
+
+void Gun::clear_tracers() {
+	tracers.clear();
+}
+
 void Gun::update() {
-	timer -= GetFrameTime();
+	timer -= tick_length;
 	if (timer <= 0.0 && active) end();
 }
 
@@ -0,0 +1,134 @@
+#include <chrono>
+#include <algorithm>
+
+#include "jobs.hh"
+
+const size_t max_workers = 7;
+
+void JobSystem::init() {
+	size_t count = 0;
+
+#ifndef __EMSCRIPTEN__
+	const size_t cores = std::thread::hardware_concurrency();
+	if (cores > 1) count = std::min(cores - 1, max_workers);
+#endif
+
+	queues.clear();
+	for (size_t i = 0; i <= count; i++) queues.push_back( std::make_unique<Queue>() );
+
+	running = true;
+	for (size_t i = 1; i <= count; i++) threads.emplace_back(work, i);
+}
+
+void JobSystem::shutdown() {
+	running = false;
+	sleep.notify_all();
+
+	for (auto& thread : threads) thread.join();
+	threads.clear();
+	queues.clear();
+}
+
+void JobSystem::submit(JobGroup& group, std::function<void()> function) {
+	// Run straight away when there are no workers
+	if ( threads.empty() ) {
+		function();
+		return;
+	}
+
+	group.remaining++;
+
+	{
+		auto& queue = *queues[thread_index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back( {std::move(function), &group} );
+	}
+
+	queued++;
+	sleep.notify_one();
+}
+
+bool JobSystem::take(std::deque<Job>& jobs, Job& job, bool newest, const JobGroup* group) {
+	if ( jobs.empty() ) return false;
+
+	// Any job, newest or oldest
+	if (!group) {
+		job = std::move( newest ? jobs.back() : jobs.front() );
+		if (newest) jobs.pop_back();
+		else jobs.pop_front();
+		return true;
+	}
+
+	// Only a job from the group, so waiting never runs somebody else's work
+	for (size_t n = 0; n < jobs.size(); n++) {
+		const size_t i = newest ? jobs.size() - 1 - n : n;
+		if (jobs[i].group != group) continue;
+
+		job = std::move(jobs[i]);
+		jobs.erase( jobs.begin() + i );
+		return true;
+	}
+
+	return false;
+}
+
+bool JobSystem::pop(Job& job, const JobGroup* group) {
+	auto& queue = *queues[thread_index];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	return take(queue.jobs, job, true, group);
+}
+
+bool JobSystem::steal(Job& job, const JobGroup* group) {
+	for (size_t offset = 1; offset < queues.size(); offset++) {
+		auto& queue = *queues[ (thread_index + offset) % queues.size() ];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if ( take(queue.jobs, job, false, group) ) return true;
+	}
+
+	return false;
+}
+
+bool JobSystem::run_one(const JobGroup* group) {
+	Job job;
+	if ( !pop(job, group) && !steal(job, group) ) return false;
+
+	queued--;
+	job.function();
+	job.group->remaining--;
+	return true;
+}
+
+void JobSystem::work(size_t index) {
+	thread_index = index;
+
+	while (running) {
+		if ( run_one() ) continue;
+
+		// Sleep until there is more work
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		sleep.wait_for( lock, std::chrono::milliseconds(1), [](){ return queued > 0 || !running; } );
+	}
+}
+
+void JobSystem::wait(JobGroup& group) {
+	while (group.remaining > 0) {
+		if ( !run_one(&group) ) std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallel_for(size_t count, size_t chunk, const std::function<void(size_t, size_t)>& body) {
+	// Small loops aren't worth splitting
+	if ( count <= chunk || threads.empty() ) {
+		body(0, count);
+		return;
+	}
+
+	JobGroup group;
+	for (size_t start = chunk; start < count; start += chunk) {
+		const size_t end = std::min(start + chunk, count);
+		submit( group, [&body, start, end](){ body(start, end); } );
+	}
+
+	body(0, chunk); // Do the first chunk on this thread
+	wait(group);
+}
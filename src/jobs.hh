@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include <entt/entt.hpp>
+
+// Counts unfinished jobs so whoever started them can wait
+struct JobGroup {
+	std::atomic<int> remaining{0};
+};
+
+// Worker threads that take jobs from each other's queues when they run out
+class JobSystem {
+private:
+	struct Job {
+		std::function<void()> function;
+		JobGroup* group;
+	};
+
+	struct Queue {
+		std::deque<Job> jobs;
+		std::mutex mutex;
+	};
+
+	inline static std::vector< std::unique_ptr<Queue> > queues; // Queue 0 belongs to the main thread
+	inline static std::vector<std::thread> threads;
+	inline static std::atomic<int> queued{0}; // Jobs waiting in any queue
+	inline static std::atomic<bool> running{false};
+	inline static std::mutex sleep_mutex;
+	inline static std::condition_variable sleep;
+	inline static thread_local size_t thread_index = 0;
+
+	static bool take(std::deque<Job>& jobs, Job& job, bool newest, const JobGroup* group);
+	static bool pop(Job& job, const JobGroup* group); // Takes the newest job from this thread's queue
+	static bool steal(Job& job, const JobGroup* group); // Takes the oldest job from another queue
+	static bool run_one(const JobGroup* group = nullptr); // Runs any job, or only one from the group
+	static void work(size_t index);
+
+public:
+	static void init(); // Starts a worker for each spare core
+	static void shutdown();
+	static void submit(JobGroup& group, std::function<void()> function);
+	static void wait(JobGroup& group); // Helps run the group's own jobs until it is done, so waiting threads never pick up each other's work
+	static void parallel_for(size_t count, size_t chunk, const std::function<void(size_t, size_t)>& body);
+	JobSystem() = delete;
+};
+
+// Calls a function for each entity in a view, split into chunks across the workers
+template<class View, class Function>
+void parallel_each(const View& view, Function function, size_t chunk = 256) {
+	std::vector<entt::entity> entities( view.begin(), view.end() );
+
+	JobSystem::parallel_for(entities.size(), chunk, [&](size_t start, size_t end) {
+		for (size_t i = start; i < end; i++) function(entities[i]);
+	});
+}
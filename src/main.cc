@@ -1,4 +1,11 @@
 #include <iostream>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
 #include <raylib-cpp.hpp>
 
 #include "typedefs.hh"
@@ -13,6 +20,13 @@
 #include "entities.hh"
 #include "particle.hh"
 #include "camera.hh"
+#include "broadphase.hh"
+#include "bullet.hh"
+#include "jobs.hh"
+#include "scheduler.hh"
+#include "renderer.hh"
+#include "snapshot.hh"
+#include "viewport.hh"
 
 using namespace raylib;
 
@@ -32,24 +46,50 @@ Timer death_timer; // Counts down when player dies
 Timer help_timer; // Shows help text for limited time
 Timer win_timer; // Shows win screen
 
+Scheduler schedule; // Systems run each step
+
+std::mutex simulation_lock; // Held while the game steps, so the main thread can restart between steps
+std::atomic<bool> restart_requested = false; // Set by the simulation, the level is reloaded on the main thread
+
 raylib::Font title_font, normal_font;
-raylib::Texture blood_bar;
-raylib::Texture intro_screen;
-raylib::Texture death_screen;
-raylib::Texture outro_screen;
+AtlasImage blood_bar;
+AtlasImage intro_screen;
+AtlasImage death_screen;
+AtlasImage outro_screen;
 
 const float G = 32.0;
+const float tick_length = 1.0 / 60.0;
+const float max_frame_time = 0.25; // Longest frame simulated before slowing down
+float render_alpha = 0.0;
 float game_time = 0.0;
 
 void game_update();
 void game_start();
+void build_schedule();
+void step();
+void simulate(const std::atomic<bool>& running);
+void request_restart();
+
+int main(int argc, char** argv) {
+	// --headless runs the game without a window as fast as it can, --steps stops it after that many steps
+	bool headless = false;
+	int step_limit = 0;
+	for (int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if (arg == "--headless") headless = true;
+		else if (arg == "--steps" && i + 1 < argc) step_limit = atoi(argv[++i]);
+	}
 
-int main() {
-	Window window(screen_width, screen_height, "Biogoth - MVP");
-
-	SetTargetFPS(60);
+	Window window;
+	if (headless) Renderer::set_backend( std::make_unique<NullBackend>() );
+	else {
+		SetConfigFlags(FLAG_VSYNC_HINT);
+		window.Init(screen_width, screen_height, "Biogoth - MVP");
+	}
 
 	load_control_config();
+	Viewport::load_config();
+	Viewport::init();
 
 	// Load sprites
 	sprite_list["guard"] = Sprite("guard");
@@ -59,41 +99,100 @@ int main() {
 	sprite_list["blood"] = Sprite("blood");
 
 	// Load sounds
-	InitAudioDevice();
-	load_sound("gun");
-	load_sound("guard_bitten");
-	load_sound("guard_death");
-	load_sound("sword_swing");
-	load_sound("sword_hit");
-
-	// Load fonts
-	title_font = raylib::Font("assets/graphics/fonts/UnifrakturCook-Bold.ttf", 128);
-	normal_font = raylib::Font("assets/graphics/fonts/PermanentMarker-Regular.ttf", 128);
+	if (!headless) {
+		InitAudioDevice();
+		load_sound("gun");
+		load_sound("guard_bitten");
+		load_sound("guard_death");
+		load_sound("sword_swing");
+		load_sound("sword_hit");
+
+		// Load fonts
+		title_font = raylib::Font("assets/graphics/fonts/UnifrakturCook-Bold.ttf", 128);
+		normal_font = raylib::Font("assets/graphics/fonts/PermanentMarker-Regular.ttf", 128);
+	}
 
 	// Load UI elements
-	blood_bar = raylib::Texture("assets/graphics/ui/blood-bar.png");
-	intro_screen = raylib::Texture("assets/graphics/ui/intro.png");
-	death_screen = raylib::Texture("assets/graphics/ui/death.png");
-	outro_screen = raylib::Texture("assets/graphics/ui/outro.png");
+	blood_bar = Atlas::add("assets/graphics/ui/blood-bar.png");
+	intro_screen = Atlas::add("assets/graphics/ui/intro.png");
+	death_screen = Atlas::add("assets/graphics/ui/death.png");
+	outro_screen = Atlas::add("assets/graphics/ui/outro.png");
+	Atlas::build(); // Packs the sprites and UI together
 
 	// Load entity definitions
 	load_entities();
 
-	game_start();
+	JobSystem::init();
+	build_schedule();
+
+	game_start(); // Publishes the first snapshot
 
 	// Display help message
 	show_help = true;
 	help_timer = Timer( 3.0, [](){show_help = false;} ); // Hide help after a few seconds
 
-	while ( !window.ShouldClose() ) {
-		game_update();
-		render_game(window);
+	// The simulation gets its own thread so a frame takes as long as the slower of stepping and drawing.
+	// Headless runs and the web build step on the main thread.
+	bool threaded = !headless;
+#ifdef __EMSCRIPTEN__
+	threaded = false;
+#endif
+
+	std::atomic<bool> simulating = true;
+	std::thread simulation;
+	if (threaded) simulation = std::thread( simulate, std::cref(simulating) );
+
+	float accumulator = 0.0;
+	int steps = 0;
+	const int stats_interval = 600; // Steps between render stats in headless runs
+
+	while ( headless ? step_limit == 0 || steps < step_limit : !window.ShouldClose() ) {
+		poll_commands();
+
+		// Voluntary reset, or the player died or won
+		if ( IsKeyPressed(KEY_R) || restart_requested.exchange(false) ) {
+			std::lock_guard<std::mutex> lock(simulation_lock);
+			game_start();
+		}
+
+		if ( IsKeyPressed(KEY_M) ) {
+			std::lock_guard<std::mutex> lock(simulation_lock);
+			stop_music();
+		}
+
+		if (!threaded) {
+			// Run as many fixed steps as fit in the time since the last frame, headless runs one each frame
+			if (headless) accumulator = tick_length;
+			else accumulator += std::min( GetFrameTime(), max_frame_time );
+
+			while (accumulator >= tick_length) {
+				step();
+				accumulator -= tick_length;
+				steps++;
+			}
+		}
+
+		// Draw between the last two steps, by how far through the current step the game is
+		const RenderSnapshot& snapshot = SnapshotBuffer::read();
+		if (threaded) render_alpha = std::clamp( float( (snapshot_clock() - snapshot.time) / tick_length ), 0.0f, 1.0f );
+		else render_alpha = accumulator / tick_length;
+
+		render_game(snapshot);
+
+		if ( headless && steps % stats_interval == 0 ) {
+			const RenderStats& stats = Renderer::stats();
+			std::cout << "Step " << steps << ": " << stats.commands << " commands, " << stats.batches << " batches, "
+				<< stats.texture_changes << " texture changes\n";
+		}
 	}
 
-	// Unload sprites
-	for (auto& [name, sprite] : sprite_list) {
-		sprite.unload();
-	}
+	simulating = false;
+	if ( simulation.joinable() ) simulation.join();
+
+	Atlas::unload();
+	Viewport::unload();
+
+	JobSystem::shutdown();
 
 	return 0;
 }
@@ -101,11 +200,18 @@ int main() {
 void game_start() {
 	game_time = 0.0;
 	registry.clear();
+	BulletPool::clear();
+	Gun::clear_tracers();
+	ParticlePool::clear();
 
 	// Load the level
-	tilemap = Tilemap("assets/levels/test.json");
+	tilemap.unload();
+	// Use the cooked level when there is one
+	if ( FileExists("assets/levels/test.lvl") ) tilemap = Tilemap("assets/levels/test.lvl");
+	else tilemap = Tilemap("assets/levels/test.json");
 
-	// Get a reference to the player
+	// Get a reference to the player, a level without one leaves it null
+	player = entt::null;
 	auto player_view = registry.view<const Player>();
 	for ( auto [entity, p] : player_view.each() ) {
 		player = entity;
@@ -120,58 +226,133 @@ void game_start() {
 
 	// Start the music
 	set_music("assets/audio/music/theme.mp3");
+
+	publish_snapshot(); // So the new level is drawn before its first step
 }
 
-void game_update() {
-	game_time += GetFrameTime();
-
-	// Player actions
-	if ( registry.get<Health>(player).now > 0 ) { // Check is the player is alive
-		// player_move();
-		// player_jump();
-		jump_buffer();
-		// player_attack();
-		// player_bite();
-	} else if ( !player_died ) {
-		player_died = true;
-		death_timer = Timer( 1.0, &game_start ); // Restart if the player is dead
-	} else { // When player is dead
-		death_timer.update();
-	}
+void request_restart() {
+	restart_requested = true;
+}
 
-	// Check for the player getting to the end of the level
-	if ( registry.get<Position>(player).value.x > 62000 && !player_won ) {
-		player_won = true;
-		win_timer = Timer( 2.0, &game_start ); // Restart if the player wins
-	}
+void step() {
+	take_commands();
+	game_update();
+	clear_commands();
+	publish_snapshot();
+}
 
-	if (player_won) win_timer.update();
+void simulate(const std::atomic<bool>& running) {
+	using clock = std::chrono::steady_clock;
+	auto last = clock::now();
+	float accumulator = 0.0;
+
+	while (running) {
+		const auto now = clock::now();
+		accumulator += std::min( std::chrono::duration<float>(now - last).count(), max_frame_time );
+		last = now;
+
+		{
+			std::lock_guard<std::mutex> lock(simulation_lock);
+			while (accumulator >= tick_length) {
+				step();
+				accumulator -= tick_length;
+			}
+		}
+
+		// Sleep until the next step is due
+		std::this_thread::sleep_for( std::chrono::duration<float>(tick_length - accumulator) );
+	}
+}
 
-	stun();
-	character_think();
-	death_by_pitfall();
-	particle_update();
+// Systems are listed in the order they run in, systems that don't touch the same data run at once
+void build_schedule() {
+	schedule.add( "store_positions", &store_positions,
+		components<Dormant>(),
+		components<Position>() );
+	schedule.add( "update_activity", &update_activity,
+		components<Character, Position>() | resources({RESOURCE_CAMERA}),
+		components<Dormant>() );
+	schedule.add( "stun", &stun,
+		Access(),
+		components<Character, Stun>() );
+	schedule.add_exclusive( "character_think", &character_think );
+	schedule.add( "death_by_pitfall", &death_by_pitfall,
+		components<Character, Position, Collider, Dormant>(),
+		components<Health>() );
+	schedule.add( "particle_update", &particle_update,
+		Access(),
+		resources({RESOURCE_PARTICLES, RESOURCE_RANDOM}) );
 
 	// Combat
-	weapon_update();
-	bullets();
+	schedule.add( "broadphase", &Broadphase::update,
+		components<Position, Collider>(),
+		resources({RESOURCE_BROADPHASE}) );
+	schedule.add_exclusive( "weapon_update", &weapon_update );
+	schedule.add_exclusive( "bullets", &bullets );
 
-	animate_character();
+	schedule.add( "animate_character", &animate_character,
+		components<Character, Velocity, Collider, Health, WeaponSet, Dormant>(),
+		components<AnimationState>() );
 
 	// Physics
-	character_movement();
-	gravity();
-	collider_overlap();
-	move_collide();
+	schedule.add( "character_movement", &character_movement,
+		components<Character, Movement, Collider, Dormant>(),
+		components<Velocity>() );
+	schedule.add( "wake_bodies", &wake_bodies,
+		components<Velocity>(),
+		components<Asleep>() );
+	schedule.add( "gravity", &gravity,
+		components<Gravity, Dormant, Asleep>(),
+		components<Velocity>() );
+	schedule.add( "collider_overlap", &collider_overlap,
+		components<Velocity, Collider, Dormant>(),
+		components<Position, Asleep>() | resources({RESOURCE_BROADPHASE}) ); // Rectangle queries stamp the entries they visit
+	schedule.add( "move_collide", &move_collide,
+		components<Dormant>(),
+		components<Position, Velocity, Collider, Asleep>() );
+
+	schedule.add( "death", &death,
+		components<Health>(),
+		components<Collider, AnimationState, Character, Movement, Stun>() | resources({RESOURCE_AUDIO, RESOURCE_RANDOM}) );
+
+	schedule.build();
+}
 
-	death();
+void game_update() {
+	game_time += tick_length;
+
+	if ( registry.valid(player) ) { // A level without a player still runs
+		// Player actions
+		if ( registry.get<Health>(player).now > 0 ) { // Check is the player is alive
+			// player_move();
+			// player_jump();
+			jump_buffer();
+			// player_attack();
+			// player_bite();
+		} else if ( !player_died ) {
+			player_died = true;
+			death_timer = Timer( 1.0, &request_restart ); // Restart if the player is dead
+		} else { // When player is dead
+			death_timer.update();
+		}
+
+		// Check for the player getting to the end of the level
+		if ( registry.get<Position>(player).value.x > 62000 && !player_won ) {
+			player_won = true;
+			win_timer = Timer( 2.0, &request_restart ); // Restart if the player wins
+		}
+	}
+
+	if (player_won) win_timer.update();
+
+	// Spawn level objects the camera is getting close to
+	tilemap.spawn_objects( CameraSystem::get_view_area() );
+
+	schedule.run();
 
 	// Audio
 	play_music();
 
-	if ( IsKeyPressed(KEY_R) ) game_start(); // Voluntary reset
-	if ( IsKeyPressed(KEY_M) ) stop_music();
-
 	// camera_update();
 	CameraSystem::update();
 
@@ -0,0 +1,116 @@
+// Doesn't include raylib because windows.h clashes with it
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+
+#include "mapped_file.hh"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& filename) {
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER file_size;
+	if ( !GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 ) {
+		close();
+		return;
+	}
+
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr) {
+		close();
+		return;
+	}
+
+	bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (bytes == nullptr) {
+		close();
+		return;
+	}
+
+	length = file_size.QuadPart;
+}
+
+void MappedFile::close() {
+	if (bytes) UnmapViewOfFile(bytes);
+	if (mapping) CloseHandle(mapping);
+	if (file) CloseHandle(file);
+
+	bytes = nullptr;
+	mapping = nullptr;
+	file = nullptr;
+	length = 0;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& filename) {
+	descriptor = open(filename.c_str(), O_RDONLY);
+	if (descriptor < 0) return;
+
+	struct stat file_info;
+	if (fstat(descriptor, &file_info) != 0 || file_info.st_size == 0) {
+		close();
+		return;
+	}
+
+	void* address = mmap(nullptr, file_info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	if (address == MAP_FAILED) {
+		close();
+		return;
+	}
+
+	bytes = (const unsigned char*)address;
+	length = file_info.st_size;
+}
+
+void MappedFile::close() {
+	if (bytes) munmap( (void*)bytes, length );
+	if (descriptor >= 0) ::close(descriptor);
+
+	bytes = nullptr;
+	descriptor = -1;
+	length = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+void MappedFile::prefetch(size_t offset, size_t size) const {
+	const size_t page = 4096;
+	volatile unsigned char sum = 0;
+
+	for (size_t i = offset; i < std::min(offset + size, length); i += page) sum += bytes[i];
+	if (size > 0 && offset + size <= length) sum += bytes[offset + size - 1];
+}
+
+void MappedFile::release(size_t offset, size_t size) const {
+	const size_t page = 4096;
+
+	// Only whole pages inside the range, the rest may still be used
+	const size_t start = (offset + page - 1) / page * page;
+	const size_t end = std::min(offset + size, length) / page * page;
+	if (start >= end) return;
+
+#ifdef _WIN32
+	VirtualUnlock( (void*)(bytes + start), end - start ); // Removes unlocked pages from the working set
+#else
+	madvise( (void*)(bytes + start), end - start, MADV_DONTNEED );
+#endif
+}
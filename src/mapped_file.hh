@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read only view of a whole file mapped into memory
+class MappedFile {
+private:
+	const unsigned char* bytes = nullptr;
+	size_t length = 0;
+
+#ifdef _WIN32
+	void* file = nullptr; // Windows handles, kept as void* so windows.h stays out of headers
+	void* mapping = nullptr;
+#else
+	int descriptor = -1;
+#endif
+
+	void close();
+
+public:
+	MappedFile(const std::string& filename);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool is_open() const { return bytes != nullptr; }
+	const unsigned char* data() const { return bytes; }
+	size_t size() const { return length; }
+
+	void prefetch(size_t offset, size_t size) const; // Reads the pages in so later reads don't wait
+	void release(size_t offset, size_t size) const; // Lets the system drop the pages, they are read again if used
+};
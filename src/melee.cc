@@ -62,7 +62,7 @@ void Melee::fire() {
 }
 
 void Melee::update() {
-	timer -= GetFrameTime();
+	timer -= tick_length;
 	if (timer <= 0.0 && active) end();
 }
 
@@ -1,92 +1,211 @@
 #include <iostream>
 #include <cmath>
-#include <entt/entt.hpp>
+#include <algorithm>
 
 #include "globals.hh"
 #include "particle.hh"
 #include "util.hh"
 #include "systems.hh"
+#include "render_queue.hh"
+#include "camera.hh"
+#include "jobs.hh"
+#include "decals.hh"
+
+void ParticlePool::start(const ParticleEmitter& emitter, size_t i) {
+	const vec2 direction = ( emitter.direction + vec2(random_spread(), random_spread()) * emitter.spread ).Normalize();
+
+	x[i] = emitter.position.x;
+	y[i] = emitter.position.y;
+	vx[i] = direction.x;
+	vy[i] = direction.y;
+	age[i] = ( float( rand() ) / float(RAND_MAX) ) * emitter.length; // Randomize age
+	hit[i] = false;
+
+	const float t = age[i] / emitter.length;
+	eased[i] = t*t*t;
+}
+
+Color ParticlePool::color_at(const ParticleEmitter& emitter, float u) {
+	return {
+		(unsigned char)( emitter.color_start.r + u * (emitter.color_end.r - emitter.color_start.r) ),
+		(unsigned char)( emitter.color_start.g + u * (emitter.color_end.g - emitter.color_start.g) ),
+		(unsigned char)( emitter.color_start.b + u * (emitter.color_end.b - emitter.color_start.b) ),
+		(unsigned char)( emitter.color_start.a + u * (emitter.color_end.a - emitter.color_start.a) )
+	};
+}
+
+void ParticlePool::emit(const ParticleEmitter& emitter) {
+	const size_t room = std::min( (size_t)std::max(emitter.count, 0), capacity - count ); // Drop particles when the pool is full
+	if (room == 0) return;
 
-void ParticleSystem::start(Particle& particle) {
-	particle.position = position;
-	particle.direction = ( direction + vec2(random_spread(), random_spread()) * spread).Normalize();
-	particle.age = ( float( rand() ) / float(RAND_MAX) ) * length; // Randomize age
+	batches.push_back( { emitter, count, room } );
+	for (size_t i = count; i < count + room; i++) start(emitter, i);
+	count += room;
 }
 
-void ParticleSystem::check_if_done() {
-	int finished = 0;
-	for (auto& particle : particles) {
-		if (particle.age > length) finished += 1;
+void ParticlePool::integrate(const ParticleEmitter& emitter, size_t start, size_t end) {
+	const float inverse_length = 1.0 / emitter.length;
+	const float speed_change = emitter.speed_end - emitter.speed_start;
+	const float gravity = G * emitter.gravity_scale * tick_length;
+
+	float* __restrict px = x.data();
+	float* __restrict py = y.data();
+	float* __restrict pvx = vx.data();
+	float* __restrict pvy = vy.data();
+	float* __restrict page = age.data();
+	float* __restrict peased = eased.data();
+
+	// No branches or calls, so the compiler can do several particles at once
+	for (size_t i = start; i < end; i++) {
+		const float speed = emitter.speed_start + peased[i] * speed_change;
+		const float length = std::sqrt( pvx[i]*pvx[i] + pvy[i]*pvy[i] );
+		const float scale = length > 0.0f ? speed / length : 0.0f;
+
+		const float velocity_x = pvx[i] * scale;
+		const float velocity_y = pvy[i] * scale + gravity * page[i];
+
+		px[i] += velocity_x * tick_length;
+		py[i] += velocity_y * tick_length;
+		pvx[i] = velocity_x;
+		pvy[i] = velocity_y;
+
+		page[i] += tick_length;
+		const float t = page[i] * inverse_length;
+		peased[i] = t*t*t;
 	}
+}
+
+void ParticlePool::collide(const ParticleEmitter& emitter, size_t start, size_t end) {
+	const float dead = emitter.length + 1.0;
 
-	if (finished == count) done = true;
+	for (size_t i = start; i < end; i++) {
+		hit[i] = tilemap.solid_point(x[i], y[i]);
+		age[i] = hit[i] ? dead : age[i];
+	}
+}
+
+void ParticlePool::stamp_decals() {
+	for (const auto& batch : batches) {
+		const ParticleEmitter& emitter = batch.emitter;
+		if (!emitter.collision) continue;
+
+		for (size_t i = batch.first; i < batch.first + batch.count; i++) {
+			if ( !hit[i] ) continue;
+
+			// Marked with the particle's size and color when it hit
+			const float size = emitter.size_start + eased[i] * (emitter.size_end - emitter.size_start);
+			const float radius = emitter.sprite ? emitter.sprite->radius(size) / 2 : size;
+			const Color color = color_at(emitter, eased[i]);
+
+			Decals::stamp( { x[i], y[i] }, std::max(radius, 1.0f), color );
+		}
+	}
 }
 
-void ParticleSystem::start() {
-	particles.resize(count);
+void ParticlePool::restart() {
+	for (const auto& batch : batches) {
+		if (!batch.emitter.loop) continue;
 
-	for (auto& particle : particles) {
-		start(particle);
+		for (size_t i = batch.first; i < batch.first + batch.count; i++)
+			if (age[i] > batch.emitter.length) start(batch.emitter, i);
 	}
 }
 
-void ParticleSystem::update() {
-	for (auto& particle : particles) {
-		// Tilemap collision
-		if ( collision && tilemap( tilemap.world_to_tile(particle.position) ) != 0 )
-			particle.age = length + 1;
+void ParticlePool::compact() {
+	size_t alive = 0;
 
-		// Restart particles
-		if (loop && particle.age > length) start(particle);
+	for (auto& batch : batches) {
+		const size_t first = alive;
 
-		// Update velocity
-		float speed = ease(particle.age/length, speed_start, speed_end);
-		vec2 velocity = particle.direction * speed;
+		for (size_t i = batch.first; i < batch.first + batch.count; i++) {
+			if (age[i] > batch.emitter.length) continue;
 
-		// Apply gravity
-		velocity.y += G * particle.age * gravity_scale * GetFrameTime();
+			x[alive] = x[i];
+			y[alive] = y[i];
+			vx[alive] = vx[i];
+			vy[alive] = vy[i];
+			age[alive] = age[i];
+			eased[alive] = eased[i];
+			hit[alive] = hit[i];
+			alive++;
+		}
 
-		// Update position and age
-		particle.position += velocity * GetFrameTime();
-		particle.direction = velocity.Normalize();
-		particle.age += GetFrameTime();
+		batch.first = first;
+		batch.count = alive - first;
 	}
 
-	if (!loop) check_if_done();
+	count = alive;
+	batches.erase(
+		std::remove_if( batches.begin(), batches.end(), [](const Batch& batch) { return batch.count == 0; } ),
+		batches.end()
+	);
 }
 
-void ParticleSystem::draw() {
-	for (auto& particle : particles) {
-		if (particle.age > length) continue; // Skip dead particles
-
-		// Update size and color
-		float size = ease(particle.age/length, size_start, size_end);
-		float rotation = atan2(particle.direction.y, particle.direction.x) * (180/PI);
-		Color color = {
-			(unsigned char)ease(particle.age/length, color_start.r, color_end.r),
-			(unsigned char)ease(particle.age/length, color_start.g, color_end.g),
-			(unsigned char)ease(particle.age/length, color_start.b, color_end.b),
-			(unsigned char)ease(particle.age/length, color_start.a, color_end.a)
-		};
-
-		if (sprite) sprite->render(particle.position, IDLE, particle.age, +1, rotation, size, color); // Draw sprite
-		else DrawCircle(particle.position.x, particle.position.y, size, color);
+void ParticlePool::update() {
+	// Cut big emitters into chunks, so a large spray is shared between the workers
+	spans.clear();
+	for (size_t b = 0; b < batches.size(); b++) {
+		const size_t end = batches[b].first + batches[b].count;
+		for (size_t start = batches[b].first; start < end; start += chunk)
+			spans.push_back( { b, start, std::min(start + chunk, end) } );
 	}
+
+	auto update_spans = [](size_t first, size_t last) {
+		for (size_t s = first; s < last; s++) {
+			const ParticleEmitter& emitter = batches[ spans[s].batch ].emitter;
+			integrate(emitter, spans[s].start, spans[s].end);
+			if (emitter.collision) collide(emitter, spans[s].start, spans[s].end);
+		}
+	};
+
+	// A few small sprays aren't worth handing out
+	if (count <= chunk) update_spans(0, spans.size());
+	else JobSystem::parallel_for(spans.size(), 1, update_spans);
+
+	stamp_decals(); // Once, before the particles are restarted or removed
+	restart();
+	compact();
 }
 
-void particle_update() {
-	for ( auto [entity, particle_system] : registry.view<ParticleSystem>().each() ) {
-		particle_system.update();
-	}
+void ParticlePool::draw() {
+	for (const auto& batch : batches) {
+		const ParticleEmitter& emitter = batch.emitter;
+
+		// Room for the largest the particles get, so they're culled before working out their look
+		const float margin = (emitter.sprite ? emitter.sprite->radius() : 1.0) * std::max(emitter.size_start, emitter.size_end);
+		const float size_change = emitter.size_end - emitter.size_start;
+
+		for (size_t i = batch.first; i < batch.first + batch.count; i++) {
+			const vec2 position(x[i], y[i]);
+			if ( !CameraSystem::in_view(position, margin) ) continue;
+
+			// Size and color follow the ease worked out in the update
+			const float u = eased[i];
+			const float size = emitter.size_start + u * size_change;
+			const Color color = color_at(emitter, u);
+
+			// Drawn between this step and the last
+			RenderQueue::set_motion( { -vx[i] * tick_length, -vy[i] * tick_length } );
 
-	// Delete particle systems when they are done
-	for ( auto [entity, particle_system] : registry.view<ParticleSystem>().each() ) {
-		if (particle_system.done) registry.destroy(entity);
+			if (emitter.sprite) {
+				const float rotation = atan2(vy[i], vx[i]) * (180/PI); // Only circles can skip it
+				emitter.sprite->render(position, IDLE, age[i], +1, rotation, size, color); // Draw sprite
+			}
+			else RenderQueue::circle(position, size, color);
+		}
 	}
 }
 
+void ParticlePool::clear() {
+	count = 0;
+	batches.clear();
+}
+
+void particle_update() {
+	ParticlePool::update();
+}
+
 void render_particles() {
-	for ( auto [entity, particle_system] : registry.view<ParticleSystem>().each() ) {
-		particle_system.draw();
-	}
+	RenderQueue::set_layer(LAYER_PARTICLES);
+	ParticlePool::draw();
 }
@@ -1,24 +1,14 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <raylib-cpp.hpp>
 
 #include "typedefs.hh"
 #include "sprite.hh"
 
-class ParticleSystem {
-private:
-	struct Particle {
-		vec2 position, direction;
-		float age;
-	};
-
-	std::vector<Particle> particles;
-
-	void start(Particle& particle); // Initializes particle
-	void check_if_done(); // Checks if the particle system has finished
-
-public:
+// Settings for a burst of particles
+struct ParticleEmitter {
 	vec2 position; // Emitter position
 	vec2 direction; // Direction particles are emmited
 	vec2 spread; // Randomization of direction
@@ -28,14 +18,50 @@ public:
 	int count;
 	bool loop;
 	bool collision;
-	bool done = false;
 	Sprite* sprite = nullptr;
 
 	float size_start, size_end;
 	float speed_start, speed_end;
 	rgba color_start, color_end;
+};
+
+// Every particle in the game stored as parallel arrays, each emitter's particles are kept together
+class ParticlePool {
+private:
+	static const size_t capacity = 16384;
+	static const size_t chunk = 1024; // Most particles updated by one job
 
-	void start();
-	void update();
-	void draw();
+	inline static std::array<float, capacity> x, y;
+	inline static std::array<float, capacity> vx, vy; // Velocity over the last step, only the direction is kept between steps
+	inline static std::array<float, capacity> age;
+	inline static std::array<float, capacity> eased; // Cubic ease of age over length, for speed, size and color
+	inline static std::array<bool, capacity> hit; // Died in a solid tile, leaves a decal
+	inline static size_t count = 0;
+
+	struct Batch {
+		ParticleEmitter emitter;
+		size_t first, count; // Particles that belong to the emitter
+	};
+
+	struct Span {
+		size_t batch, start, end;
+	};
+
+	inline static std::vector<Batch> batches;
+	inline static std::vector<Span> spans; // Batches cut into chunks for the workers
+
+	static void start(const ParticleEmitter& emitter, size_t i); // Initializes a particle
+	static Color color_at(const ParticleEmitter& emitter, float u); // Color at an eased age
+	static void integrate(const ParticleEmitter& emitter, size_t start, size_t end);
+	static void collide(const ParticleEmitter& emitter, size_t start, size_t end); // Kills particles inside solid tiles
+	static void stamp_decals(); // Leaves a mark where particles hit the level
+	static void restart(); // Starts dead particles of looping emitters again
+	static void compact(); // Removes dead particles and finished emitters
+
+public:
+	static void emit(const ParticleEmitter& emitter);
+	static void update();
+	static void draw();
+	static void clear();
+	ParticlePool() = delete;
 };
@@ -6,11 +6,23 @@
 #include "components.hh"
 #include "systems.hh"
 #include "util.hh"
+#include "broadphase.hh"
+#include "collision.hh"
+#include "jobs.hh"
+
+void store_positions() {
+	auto view = registry.view<Position>(entt::exclude<Dormant>);
+	parallel_each(view, [&](entt::entity entity) {
+		auto& position = view.get<Position>(entity);
+		position.previous = position.value;
+	});
+}
 
 void character_movement() {
-	auto view = registry.view<Character, Movement, Collider, Velocity>();
-	for ( auto [entity, character, movement, collider, velocity] : view.each() ) {
-		if (!movement.can_move) continue;
+	auto view = registry.view<const Character, const Movement, const Collider, Velocity>(entt::exclude<Dormant>);
+	parallel_each(view, [&](entt::entity entity) {
+		auto [movement, collider, velocity] = view.get<const Movement, const Collider, Velocity>(entity);
+		if (!movement.can_move) return;
 
 		float wish_speed = movement.max_speed * movement.direction.x;
 
@@ -26,8 +38,8 @@ void character_movement() {
 			speed_change = deceleration; // Decelerate if no input
 
 		// Move velocity towards target velocity
-		velocity.value.x = move_towards( velocity.value.x, wish_speed, speed_change * GetFrameTime() );
-	}
+		velocity.value.x = move_towards( velocity.value.x, wish_speed, speed_change * tick_length );
+	});
 }
 
 // Finds the direction a collision comes from
@@ -40,23 +52,20 @@ vec2 overlap_direction(const Position& position, const Collider& collider) {
 	int start_y = (position.value.y - collider.height) / tilemap.tile_size;
 	int end_y = (position.value.y - e) / tilemap.tile_size;
 
-	for (int x=start_x; x<=end_x; x++)
-	for (int y=start_y; y<=end_y; y++) {
-		if ( !tilemap.tile_in_map(x, y) ) continue; // If the coordinate is out of bounds go to the next one
-		if ( tilemap(x, y) == empty_tile ) continue;
-
-		if (x == start_x) direction.x = -1;
-		else if (x == end_x) direction.x = +1;
+	// Check the edge columns and rows of the collider
+	if ( tilemap.solid_box(start_x, start_y, start_x, end_y) ) direction.x = -1;
+	if ( end_x != start_x && tilemap.solid_box(end_x, start_y, end_x, end_y) ) direction.x = +1;
 
-		if (y == start_y) direction.y = -1;
-		else if (y == end_y) direction.y = +1;
-	}
+	if ( tilemap.solid_span(start_x, end_x, start_y) ) direction.y = -1;
+	if ( end_y != start_y && tilemap.solid_span(start_x, end_x, end_y) ) direction.y = +1;
 
 	return direction; // Return false if no solid tiles were found
 }
 
 void move_collide() {
-	auto view = registry.view<Position, Velocity, Collider>();
+	std::vector<entt::entity> resting;
+
+	auto view = registry.view<Position, Velocity, Collider>(entt::exclude<Dormant, Asleep>);
 	for ( auto [entity, position, velocity, collider] : view.each() ) {
 		vec2 direction; // Direction the collision comes from
 
@@ -74,8 +83,8 @@ void move_collide() {
 		);
 
 		// Upper corner collision
-		bool left_collide = tilemap.tile_in_map(left_side) && tilemap(left_side) != empty_tile;
-		bool right_collide = tilemap.tile_in_map(right_side) && tilemap(right_side) != empty_tile;
+		bool left_collide = tilemap.solid(left_side);
+		bool right_collide = tilemap.solid(right_side);
 
 		// Slide around corner
 		const float corner_push = 3;
@@ -85,10 +94,12 @@ void move_collide() {
 			position.value.x -= corner_push;
 		}
 
-		// Move the entity
-		position.value.x += velocity.value.x;
+		// Move the entity up to the first wall in its path
+		SweepHit hit = sweep_box( collider.get_rectangle(position.value), vec2(velocity.value.x, 0.0) );
+		position.value.x += velocity.value.x * hit.time;
+		if (hit.hit) velocity.value.x = 0.0;
 
-		// Check for collision
+		// Push out of any tiles it was already overlapping
 		direction = overlap_direction(position, collider);
 		if ( direction.x != 0 ) {
 			// From left
@@ -105,7 +116,17 @@ void move_collide() {
 		}
 
 		// Repeat for the other axis
-		position.value.y += velocity.value.y;
+		hit = sweep_box( collider.get_rectangle(position.value), vec2(0.0, velocity.value.y) );
+		position.value.y += velocity.value.y * hit.time;
+
+		// Landed on the floor
+		if ( hit.hit && hit.normal.y < 0 ) {
+			collider.on_floor = true;
+			velocity.value.y = 0.0;
+		}
+
+		// Hit the ceiling, only stop when not at corner
+		if ( hit.hit && hit.normal.y > 0 && left_collide && right_collide ) velocity.value.y = 0.0;
 
 		direction = overlap_direction(position, collider);
 		if ( direction.y != 0 ) {
@@ -125,38 +146,65 @@ void move_collide() {
 			}
 		}
 
+		// Bodies that haven't moved this step and are on the floor can sleep
+		bool still = velocity.value.x == 0.0 && velocity.value.y == 0.0 && position.value == position.previous;
+		if ( still && collider.on_floor ) resting.push_back(entity);
+	}
+
+	for ( auto entity : resting ) registry.emplace<Asleep>(entity);
+}
+
+void wake_bodies() {
+	std::vector<entt::entity> moving;
+
+	auto view = registry.view<const Asleep, const Velocity>();
+	for ( auto entity : view ) {
+		const auto& velocity = view.get<const Velocity>(entity);
+		if ( velocity.value.x != 0.0 || velocity.value.y != 0.0 ) moving.push_back(entity);
 	}
+
+	for ( auto entity : moving ) registry.remove<Asleep>(entity);
 }
 
 void gravity() {
-	auto view = registry.view<Velocity, const Gravity>();
-	for ( auto [entity, velocity, gravity] : view.each() ) {
-		velocity.value.y += G * gravity.scale * GetFrameTime();
-	}
+	auto view = registry.view<Velocity, const Gravity>(entt::exclude<Dormant, Asleep>);
+	parallel_each(view, [&](entt::entity entity) {
+		auto [velocity, gravity] = view.get<Velocity, const Gravity>(entity);
+		velocity.value.y += G * gravity.scale * tick_length;
+	});
 }
 
 void collider_overlap() {
 	const float push_speed = 8.0;
+	std::vector<entt::entity> candidates;
 
 	auto view = registry.view<Velocity, Position, const Collider>();
-	for ( auto entity : view )
-	for ( auto other : view ) {
-		if (entity == other) continue; // Skip self
+	auto active_view = registry.view<Velocity, Position, const Collider>(entt::exclude<Dormant>);
+	for ( auto [entity, velocity, position, collider] : active_view.each() ) {
+		if ( !collider.enabled ) continue;
 
-		auto& position = view.get<Position>(entity);
-		auto& collider = view.get<Collider>(entity);
-		auto& velocity = view.get<Velocity>(entity);
-		auto& other_position = view.get<Position>(other);
-		auto& other_collider = view.get<Collider>(other);
+		// Only test the colliders sharing a grid cell
+		candidates.clear();
+		Broadphase::query( collider.get_rectangle(position.value), candidates );
+
+		for ( auto other : candidates ) {
+			if (entity == other) continue; // Skip self
+			if ( !view.contains(other) ) continue;
+
+			auto& other_position = view.get<Position>(other);
+			auto& other_collider = view.get<Collider>(other);
 
-		if ( !collider.enabled || !other_collider.enabled ) continue;
+			if ( !other_collider.enabled ) continue;
 
-		// Check for collision
-		bool collided = collider.get_rectangle(position.value).CheckCollision( other_collider.get_rectangle(other_position.value) );
-		if ( !collided ) continue;
+			// Check for collision
+			bool collided = collider.get_rectangle(position.value).CheckCollision( other_collider.get_rectangle(other_position.value) );
+			if ( !collided ) continue;
 
-		// Push away if they overlap
-		if (position.value.x < other_position.value.x) position.value.x += -push_speed;
-		else position.value.x += push_speed;
+			// Push away if they overlap
+			if (position.value.x < other_position.value.x) position.value.x += -push_speed;
+			else position.value.x += push_speed;
+
+			registry.remove<Asleep>(entity); // Wake the body so it collides this step
+		}
 	}
 }
@@ -49,8 +49,8 @@ void player_jump() {
 		TileCoord left_side = tilemap.world_to_tile( position.value.x - collider.width/2 - 4, position.value.y - 1 );
 		TileCoord right_side = tilemap.world_to_tile( position.value.x + collider.width/2 + 4, position.value.y - 1 );
 
-		if ( tilemap(left_side) != empty_tile ) collider.wall_direction = -1;
-		if ( tilemap(right_side) != empty_tile ) collider.wall_direction = +1;
+		if ( tilemap.solid(left_side) ) collider.wall_direction = -1;
+		if ( tilemap.solid(right_side) ) collider.wall_direction = +1;
 
 		if ( collider.wall_direction != 0 && !collider.on_floor ) facing.direction = -collider.wall_direction;
 
@@ -67,7 +67,7 @@ void player_jump() {
 void jump_buffer() {
 	auto view = registry.view<const Player, Position, Velocity, Collider, Gravity, Jump>();
 	for ( auto [entity, player, position, velocity, collider, gravity, jump] : view.each() ) {
-		jump.buffer_timer -= GetFrameTime();
+		jump.buffer_timer -= tick_length;
 		if (jump.buffer_timer <= 0) jump.wish_jump = false;
 
 		// Check for key press
@@ -46,8 +46,8 @@ void PlayerBrain::jump() {
 	TileCoord left_side = tilemap.world_to_tile( position.value.x - collider.width/2 - 4, position.value.y - 1 );
 	TileCoord right_side = tilemap.world_to_tile( position.value.x + collider.width/2 + 4, position.value.y - 1 );
 
-	if ( tilemap(left_side) != empty_tile ) collider.wall_direction = -1;
-	if ( tilemap(right_side) != empty_tile ) collider.wall_direction = +1;
+	if ( tilemap.solid(left_side) ) collider.wall_direction = -1;
+	if ( tilemap.solid(right_side) ) collider.wall_direction = +1;
 
 	if ( collider.wall_direction != 0 && !collider.on_floor ) facing.direction = -collider.wall_direction;
 
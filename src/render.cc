@@ -6,68 +6,105 @@
 #include "components.hh"
 #include "systems.hh"
 #include "camera.hh"
+#include "bullet.hh"
+#include "render_queue.hh"
+#include "renderer.hh"
+#include "snapshot.hh"
+#include "viewport.hh"
 
-void render_game(raylib::Window& window) {
-	BeginDrawing();
-	CameraSystem::get_camera().BeginMode();
+void publish_snapshot() {
+	RenderSnapshot& snapshot = SnapshotBuffer::write();
 
-		window.ClearBackground( rgba(111, 133, 163, 255) );
+	render_colliders();
+	render_collider_sprites();
+	render_bullets();
+	render_particles();
+	RenderQueue::publish(snapshot.items); // Sorted by layer and texture
 
-		tilemap.draw();
+	snapshot.camera = CameraSystem::get_state();
+	snapshot.time = snapshot_clock();
+
+	snapshot.has_player = registry.valid(player) && registry.all_of<Health>(player);
+	if (snapshot.has_player) {
+		const auto& health = registry.get<Health>(player);
+		snapshot.player_health = float(health.now) / float(health.max);
+	}
+
+	snapshot.show_help = show_help;
+	snapshot.player_died = player_died;
+	snapshot.player_won = player_won;
+
+	SnapshotBuffer::publish();
+}
+
+void render_game(const RenderSnapshot& snapshot) {
+	CameraSystem::interpolate(snapshot.camera, render_alpha);
+	tilemap.prepare(); // Baking chunks resets the camera so it's done before drawing
 
-		render_colliders();
-		render_collider_sprites();
-		render_bullets();
-		render_particles();
+	// The world may be drawn smaller than the window and scaled up
+	Viewport::begin();
+	Renderer::clear( rgba(111, 133, 163, 255) );
+	Renderer::begin_camera( CameraSystem::get_camera() );
 
-	CameraSystem::get_camera().EndMode();
+		tilemap.draw();
+		RenderQueue::record(snapshot.items, render_alpha);
+
+	Renderer::end_camera();
+	Viewport::end();
 
-	// UI
-	health_bar();
-	if (show_help) help_text();
-	else if (player_died) death_text();
-	else if (player_won) end_text();
+	// UI stays at the window's resolution
+	if (snapshot.has_player) health_bar(snapshot.player_health);
+	if (snapshot.show_help) help_text();
+	else if (snapshot.player_died) death_text();
+	else if (snapshot.player_won) end_text();
 
 	// DrawFPS(10, 10);
 
-	EndDrawing();
+	Renderer::present(); // Draws the recorded frame, or only counts it when headless
 }
 
 void render_colliders() {
+	RenderQueue::set_layer(LAYER_COLLIDERS);
+
 	auto view = registry.view<const Position, const Collider, const DebugColor>();
 	for ( auto [entity, position, collider, color] : view.each() ) {
-		collider.get_rectangle(position.value).Draw(color.color);
+		const raylib::Rectangle rectangle = collider.get_rectangle(position.value);
+		if ( !CameraSystem::in_view(rectangle) ) continue;
+
+		RenderQueue::set_motion(position.previous - position.value);
+		RenderQueue::rectangle(rectangle, color.color);
 	}
 }
 
 void render_bullets() {
-	auto view = registry.view<const Position, const Bullet, const Velocity>();
-	for ( auto [entity, position, bullet, velocity] : view.each() ) {
-		float rotation = atan2(velocity.value.y, velocity.value.x) * (180/PI);
-
-		// Render the bullet sprite
-		if (bullet.sprite)
-			bullet.sprite->render(position.value, IDLE, 0.0, +1, rotation);
-		else
-			DrawCircleV(position.value, 4, ORANGE);
-	}
+	RenderQueue::set_layer(LAYER_BULLETS);
+	BulletPool::draw();
+	RenderQueue::set_motion( {0, 0} ); // Tracers stay where they were fired
+	Gun::draw_tracers();
 }
 
 void render_collider_sprites() {
+	RenderQueue::set_layer(LAYER_CHARACTERS);
+
 	auto view = registry.view<const Position, const Collider, AnimationState, const Facing>();
 	for ( auto [entity, position, collider, animation, facing] : view.each() ) {
+		// Off screen sprites aren't drawn or animated
+		vec2 location = position.value;
+		if ( !CameraSystem::in_view( location - vec2(0, collider.height/2), animation.sprite->radius() ) ) continue;
+
 		// Update the timer
-		animation.timer += GetFrameTime();
+		animation.timer += tick_length;
 
 		// Pause at end of death animation
 		const float death_length = float(animation.sprite->length[DIE]) / float(animation.sprite->rate);
 		if ( animation.state == DIE && animation.timer >= death_length ) {
-			animation.timer = death_length - GetFrameTime();
+			animation.timer = death_length - tick_length;
 		}
 
-		// Render the sprite
+		// Render the sprite, drawn between this step and the last
+		RenderQueue::set_motion(position.previous - position.value);
 		animation.sprite->render(
-			position.value.x, position.value.y - collider.height/2,
+			location.x, location.y - collider.height/2,
 			animation.state,
 			animation.timer,
 			facing.direction
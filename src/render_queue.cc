@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <raylib-cpp.hpp>
+
+#include "render_queue.hh"
+
+void RenderQueue::set_layer(RenderLayer new_layer) {
+	layer = new_layer;
+	motion = {0, 0};
+}
+
+void RenderQueue::set_motion(Vector2 new_motion) {
+	motion = new_motion;
+}
+
+void RenderQueue::push(unsigned int texture_id, const RenderCommand& command) {
+	items.push_back( { (uint64_t(layer) << 32) | texture_id, command, motion } ); // Shapes share texture 0
+}
+
+void RenderQueue::texture(Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, float rotation, Color tint) {
+	RenderCommand command = {};
+	command.type = RenderCommandType::TEXTURE;
+	command.quad = { texture, source, dest, origin, rotation };
+	command.color = tint;
+	push(texture.id, command);
+}
+
+void RenderQueue::rectangle(Rectangle rectangle, Color color) {
+	RenderCommand command = {};
+	command.type = RenderCommandType::RECTANGLE;
+	command.rectangle = rectangle;
+	command.color = color;
+	push(0, command);
+}
+
+void RenderQueue::circle(Vector2 center, float radius, Color color) {
+	RenderCommand command = {};
+	command.type = RenderCommandType::CIRCLE;
+	command.circle = { center, radius };
+	command.color = color;
+	push(0, command);
+}
+
+void RenderQueue::line(Vector2 start, Vector2 end, float thickness, Color color) {
+	RenderCommand command = {};
+	command.type = RenderCommandType::LINE;
+	command.line = { start, end, thickness };
+	command.color = color;
+	push(0, command);
+}
+
+void RenderQueue::publish(std::vector<DrawItem>& sorted) {
+	// Stable, so items that share a layer and texture keep the order they were submitted in
+	std::stable_sort( items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) { return a.key < b.key; } );
+
+	// Swapping keeps the memory of both vectors for later steps
+	sorted.swap(items);
+	items.clear();
+	set_layer(LAYER_COLLIDERS);
+}
+
+void RenderQueue::record(const std::vector<DrawItem>& sorted, float alpha) {
+	for (const auto& item : sorted) {
+		RenderCommand command = item.command;
+		const float x = item.motion.x * (1.0 - alpha);
+		const float y = item.motion.y * (1.0 - alpha);
+
+		switch (command.type) {
+			case RenderCommandType::TEXTURE:
+				command.quad.dest.x += x;
+				command.quad.dest.y += y;
+				break;
+
+			case RenderCommandType::RECTANGLE:
+				command.rectangle.x += x;
+				command.rectangle.y += y;
+				break;
+
+			case RenderCommandType::CIRCLE:
+				command.circle.center.x += x;
+				command.circle.center.y += y;
+				break;
+
+			case RenderCommandType::LINE:
+				command.line.start.x += x;
+				command.line.start.y += y;
+				command.line.end.x += x;
+				command.line.end.y += y;
+				break;
+
+			default:
+				break;
+		}
+
+		Renderer::add(command);
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <raylib-cpp.hpp>
+
+#include "renderer.hh"
+
+// Drawn back to front, items on the same layer are grouped by texture
+enum RenderLayer {
+	LAYER_COLLIDERS,
+	LAYER_CHARACTERS,
+	LAYER_BULLETS,
+	LAYER_PARTICLES,
+
+	LAYER_COUNT
+};
+
+struct DrawItem {
+	uint64_t key; // Layer then texture, so sorting puts items that share state together
+	RenderCommand command;
+	Vector2 motion; // From where it is back to where it was the step before, for drawing between steps
+};
+
+// Collects the draws of the world after each step and sorts them, so raylib can batch them when they're drawn
+class RenderQueue {
+private:
+	inline static std::vector<DrawItem> items;
+	inline static RenderLayer layer = LAYER_COLLIDERS;
+	inline static Vector2 motion = {0, 0};
+
+	static void push(unsigned int texture_id, const RenderCommand& command);
+
+public:
+	static void set_layer(RenderLayer layer); // Layer of the items submitted after this, also clears the motion
+	static void set_motion(Vector2 motion); // How far the items submitted after this move back to the last step
+	static void texture(Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, float rotation, Color tint);
+	static void rectangle(Rectangle rectangle, Color color);
+	static void circle(Vector2 center, float radius, Color color);
+	static void line(Vector2 start, Vector2 end, float thickness, Color color);
+	static void publish(std::vector<DrawItem>& sorted); // Sorts everything submitted into a snapshot, on the simulation thread
+	static void record(const std::vector<DrawItem>& sorted, float alpha); // Records a snapshot's items into the renderer, moved between the steps
+	RenderQueue() = delete;
+};
@@ -0,0 +1,174 @@
+#include <raylib-cpp.hpp>
+
+#include "renderer.hh"
+
+void RaylibBackend::execute(const std::vector<RenderCommand>& commands) {
+	BeginDrawing();
+
+	for (const auto& command : commands) {
+		switch (command.type) {
+			case RenderCommandType::CLEAR:
+				ClearBackground(command.color);
+				break;
+
+			case RenderCommandType::BEGIN_CAMERA:
+				BeginMode2D(command.camera);
+				break;
+
+			case RenderCommandType::END_CAMERA:
+				EndMode2D();
+				break;
+
+			case RenderCommandType::BLEND_MODE:
+				BeginBlendMode(command.blend_mode);
+				break;
+
+			case RenderCommandType::BEGIN_TARGET:
+				BeginTextureMode(command.target);
+				break;
+
+			case RenderCommandType::END_TARGET:
+				EndTextureMode();
+				break;
+
+			case RenderCommandType::TEXTURE:
+				DrawTexturePro(command.quad.texture, command.quad.source, command.quad.dest, command.quad.origin, command.quad.rotation, command.color);
+				break;
+
+			case RenderCommandType::RECTANGLE:
+				DrawRectangleRec(command.rectangle, command.color);
+				break;
+
+			case RenderCommandType::GRADIENT_V:
+				DrawRectangleGradientV(
+					command.rectangle.x, command.rectangle.y, command.rectangle.width, command.rectangle.height,
+					command.color, command.color_end
+				);
+				break;
+
+			case RenderCommandType::CIRCLE:
+				DrawCircleV(command.circle.center, command.circle.radius, command.color);
+				break;
+
+			case RenderCommandType::LINE:
+				DrawLineEx(command.line.start, command.line.end, command.line.thickness, command.color);
+				break;
+		}
+	}
+
+	EndDrawing();
+}
+
+void Renderer::set_backend(std::unique_ptr<RenderBackend> new_backend) {
+	backend = std::move(new_backend);
+}
+
+Texture2D Renderer::placeholder_texture(int width, int height) {
+	return { placeholder_id++, width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
+
+RenderCommand& Renderer::record(RenderCommandType type) {
+	commands.push_back({});
+	commands.back().type = type;
+	return commands.back();
+}
+
+void Renderer::add(const RenderCommand& command) {
+	commands.push_back(command);
+}
+
+void Renderer::clear(Color color) {
+	record(RenderCommandType::CLEAR).color = color;
+}
+
+void Renderer::begin_camera(const Camera2D& camera) {
+	record(RenderCommandType::BEGIN_CAMERA).camera = camera;
+}
+
+void Renderer::end_camera() {
+	record(RenderCommandType::END_CAMERA);
+}
+
+void Renderer::blend_mode(int mode) {
+	record(RenderCommandType::BLEND_MODE).blend_mode = mode;
+}
+
+void Renderer::begin_target(const RenderTexture2D& target) {
+	record(RenderCommandType::BEGIN_TARGET).target = target;
+}
+
+void Renderer::end_target() {
+	record(RenderCommandType::END_TARGET);
+}
+
+void Renderer::texture(Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, float rotation, Color tint) {
+	RenderCommand& command = record(RenderCommandType::TEXTURE);
+	command.quad = { texture, source, dest, origin, rotation };
+	command.color = tint;
+}
+
+void Renderer::rectangle(Rectangle rectangle, Color color) {
+	RenderCommand& command = record(RenderCommandType::RECTANGLE);
+	command.rectangle = rectangle;
+	command.color = color;
+}
+
+void Renderer::gradient_v(Rectangle rectangle, Color top, Color bottom) {
+	RenderCommand& command = record(RenderCommandType::GRADIENT_V);
+	command.rectangle = rectangle;
+	command.color = top;
+	command.color_end = bottom;
+}
+
+void Renderer::circle(Vector2 center, float radius, Color color) {
+	RenderCommand& command = record(RenderCommandType::CIRCLE);
+	command.circle = { center, radius };
+	command.color = color;
+}
+
+void Renderer::line(Vector2 start, Vector2 end, float thickness, Color color) {
+	RenderCommand& command = record(RenderCommandType::LINE);
+	command.line = { start, end, thickness };
+	command.color = color;
+}
+
+RenderStats Renderer::count() {
+	RenderStats stats;
+	stats.commands = commands.size();
+
+	// Shapes use raylib's blank texture, circles and lines are triangles rather than quads
+	unsigned int texture = 0;
+	int primitive = -1;
+	bool state_changed = true;
+
+	for (const auto& command : commands) {
+		if (command.type == RenderCommandType::CLEAR) continue;
+
+		if (
+			command.type == RenderCommandType::BEGIN_CAMERA || command.type == RenderCommandType::END_CAMERA ||
+			command.type == RenderCommandType::BLEND_MODE ||
+			command.type == RenderCommandType::BEGIN_TARGET || command.type == RenderCommandType::END_TARGET
+		) {
+			state_changed = true;
+			continue;
+		}
+
+		const unsigned int command_texture = command.type == RenderCommandType::TEXTURE ? command.quad.texture.id : 0;
+		const int command_primitive = command.type == RenderCommandType::CIRCLE || command.type == RenderCommandType::LINE ? 1 : 0;
+
+		if (command_texture != texture) stats.texture_changes++;
+		if (state_changed || command_texture != texture || command_primitive != primitive) stats.batches++;
+
+		texture = command_texture;
+		primitive = command_primitive;
+		state_changed = false;
+	}
+
+	return stats;
+}
+
+void Renderer::present() {
+	last_stats = count();
+	backend->execute(commands);
+	commands.clear();
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <raylib-cpp.hpp>
+
+enum class RenderCommandType : uint8_t {
+	CLEAR,
+	BEGIN_CAMERA,
+	END_CAMERA,
+	BLEND_MODE,
+	BEGIN_TARGET,
+	END_TARGET,
+	TEXTURE,
+	RECTANGLE,
+	GRADIENT_V,
+	CIRCLE,
+	LINE,
+};
+
+// One recorded draw, only the member for its type is set
+struct RenderCommand {
+	RenderCommandType type;
+	Color color, color_end; // Gradients go from color to color_end
+
+	union {
+		struct { Texture2D texture; Rectangle source, dest; Vector2 origin; float rotation; } quad;
+		Rectangle rectangle;
+		struct { Vector2 center; float radius; } circle;
+		struct { Vector2 start, end; float thickness; } line;
+		Camera2D camera;
+		int blend_mode;
+		RenderTexture2D target;
+	};
+};
+
+// Counted when a frame is recorded, so they're there without a window
+struct RenderStats {
+	int commands = 0;
+	int batches = 0; // Draw calls raylib would make, a new one starts when the texture, primitive or state changes
+	int texture_changes = 0;
+};
+
+// Carries out a frame of recorded commands
+class RenderBackend {
+public:
+	virtual void execute(const std::vector<RenderCommand>& commands) = 0;
+	virtual bool has_gpu() const = 0; // False when there is no window or GL context to load textures into
+	virtual ~RenderBackend() {}
+};
+
+class RaylibBackend : public RenderBackend {
+public:
+	void execute(const std::vector<RenderCommand>& commands) override;
+	bool has_gpu() const override { return true; }
+};
+
+// Draws nothing, for headless runs
+class NullBackend : public RenderBackend {
+public:
+	void execute(const std::vector<RenderCommand>& commands) override {}
+	bool has_gpu() const override { return false; }
+};
+
+// Records the draws of a frame into one buffer and hands it to the backend at the end
+class Renderer {
+private:
+	inline static std::vector<RenderCommand> commands;
+	inline static std::unique_ptr<RenderBackend> backend = std::make_unique<RaylibBackend>();
+	inline static RenderStats last_stats;
+	inline static unsigned int placeholder_id = 1u << 30; // Stand in texture ids, far from the ones GL hands out
+
+	static RenderCommand& record(RenderCommandType type);
+	static RenderStats count(); // Works out the stats of the recorded commands
+
+public:
+	static void set_backend(std::unique_ptr<RenderBackend> new_backend);
+	static bool has_gpu() { return backend->has_gpu(); }
+	static Texture2D placeholder_texture(int width, int height); // Texture with a unique id that was never loaded, for headless runs
+
+	static void clear(Color color);
+	static void begin_camera(const Camera2D& camera);
+	static void end_camera();
+	static void blend_mode(int mode);
+	static void begin_target(const RenderTexture2D& target); // Draws into a texture instead of the window
+	static void end_target();
+	static void texture(Texture2D texture, Rectangle source, Rectangle dest, Vector2 origin, float rotation, Color tint);
+	static void rectangle(Rectangle rectangle, Color color);
+	static void gradient_v(Rectangle rectangle, Color top, Color bottom);
+	static void circle(Vector2 center, float radius, Color color);
+	static void line(Vector2 start, Vector2 end, float thickness, Color color);
+	static void add(const RenderCommand& command); // Adds a command recorded somewhere else, like the render queue
+
+	static void present(); // Sends the frame to the backend and starts a new one
+	static const RenderStats& stats() { return last_stats; } // Stats of the last frame presented
+	Renderer() = delete;
+};
@@ -0,0 +1,54 @@
+#include <algorithm>
+
+#include "scheduler.hh"
+#include "jobs.hh"
+
+Access resources(std::initializer_list<Resource> list) {
+	Access mask;
+	for (auto resource : list) mask.set(resource);
+	return mask;
+}
+
+bool Scheduler::conflict(const System& a, const System& b) {
+	if (a.exclusive || b.exclusive) return true;
+
+	// Writing something another system reads or writes
+	return (a.writes & (b.reads | b.writes)).any() || (b.writes & a.reads).any();
+}
+
+void Scheduler::add(const char* name, void (*function)(), Access reads, Access writes) {
+	systems.push_back( {name, function, reads, writes, false} );
+}
+
+void Scheduler::add_exclusive(const char* name, void (*function)()) {
+	systems.push_back( {name, function, Access(), Access(), true} );
+}
+
+void Scheduler::build() {
+	std::vector<size_t> stage_of( systems.size() );
+	stages.clear();
+
+	// Each system goes in the stage after the last earlier system it conflicts with
+	for (size_t i = 0; i < systems.size(); i++) {
+		size_t stage = 0;
+		for (size_t j = 0; j < i; j++) {
+			if ( conflict(systems[i], systems[j]) ) stage = std::max(stage, stage_of[j] + 1);
+		}
+
+		stage_of[i] = stage;
+		if ( stage >= stages.size() ) stages.resize(stage + 1);
+		stages[stage].push_back(i);
+	}
+}
+
+void Scheduler::run() {
+	for (const auto& stage : stages) {
+		JobGroup group;
+
+		// Hand all but the first system to the workers
+		for (size_t i = 1; i < stage.size(); i++) JobSystem::submit( group, systems[ stage[i] ].function );
+
+		systems[ stage[0] ].function();
+		JobSystem::wait(group);
+	}
+}
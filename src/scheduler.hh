@@ -0,0 +1,62 @@
+#pragma once
+
+#include <bitset>
+#include <vector>
+#include <initializer_list>
+
+#include "globals.hh"
+
+// Shared state systems use that isn't a component.
+// Adding or removing a component counts as writing it. Systems that create or destroy entities run exclusively.
+enum Resource {
+	RESOURCE_RANDOM,
+	RESOURCE_AUDIO,
+	RESOURCE_BROADPHASE,
+	RESOURCE_CAMERA,
+	RESOURCE_PARTICLES,
+
+	RESOURCE_COUNT
+};
+
+typedef std::bitset<64> Access; // One bit for each resource and component type
+
+inline size_t next_access_bit = RESOURCE_COUNT;
+
+template<class Component>
+size_t access_bit() {
+	static const size_t bit = next_access_bit++;
+	return bit;
+}
+
+// Creates the storage for each component so views never change the registry from a worker
+template<class... Components>
+Access components() {
+	Access mask;
+	( mask.set( access_bit<Components>() ), ... );
+	( (void)registry.storage<Components>(), ... );
+	return mask;
+}
+
+Access resources(std::initializer_list<Resource> list);
+
+// Runs systems in order, except systems that don't share data run at the same time
+class Scheduler {
+private:
+	struct System {
+		const char* name;
+		void (*function)();
+		Access reads, writes;
+		bool exclusive; // Runs alone on the main thread
+	};
+
+	std::vector<System> systems;
+	std::vector< std::vector<size_t> > stages; // Systems that can run together
+
+	static bool conflict(const System& a, const System& b);
+
+public:
+	void add(const char* name, void (*function)(), Access reads, Access writes);
+	void add_exclusive(const char* name, void (*function)());
+	void build();
+	void run();
+};
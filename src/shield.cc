@@ -7,6 +7,7 @@
 #include "weapon.hh"
 #include "systems.hh"
 #include "util.hh"
+#include "bullet.hh"
 
 Shield::Shield(entt::entity owner, toml::value data) {
 	this->owner = owner;
@@ -58,37 +59,31 @@ void Shield::fire() {
 void Shield::update() {
 	if (!active) return;
 
-	timer -= GetFrameTime();
+	timer -= tick_length;
+
+	// Destroy or deflect any bullets in front of the character
+	raylib::Rectangle rect;
+	if ( blocking_area(rect) ) {
+		const auto& position = registry.get<Position>(owner);
+		BulletPool::block(rect, position.value.x, deflect, owner);
+	}
+
 	if (timer <= 0.0) end();
-	if (timer > length) return; // Don't do anything pass the blocking window
+}
+
+bool Shield::blocking_area(raylib::Rectangle& area) const {
+	if (!active || timer > length) return false; // Don't do anything pass the blocking window
 
 	auto& position = *registry.try_get<Position>(owner);
 	auto& collider = *registry.try_get<Collider>(owner);
 	auto& facing = *registry.try_get<Facing>(owner);
 
 	// Create a rectangle in front of the character
-	raylib::Rectangle rect;
-	rect.x = position.value.x + (collider.width/2) * facing.direction;
-	rect.y = position.value.y - collider.height;
-	rect.width = width;
-	rect.height = collider.height;
-
-	// Check for any bullets in the rectangle
-	auto view = registry.view<Position, Velocity, const Bullet>();
-	for ( auto [bullet, bullet_position, bullet_velocity, bullet_component] : view.each() ) {
-		if ( !bullet_position.value.CheckCollision(rect) ) continue;
-
-		// If deflect is false, destroy them
-		if (!deflect) {
-			registry.destroy(bullet);
-			continue;
-		}
-
-		// If deflect is true,
-		// 	If the bullet is traveling towards the character, reverse its direction
-		if ( sign(bullet_velocity.value.x) == sign(position.value.x - bullet_position.value.x) )
-			bullet_velocity.value.x *= -1;
-	}
+	area.x = position.value.x + (collider.width/2) * facing.direction;
+	area.y = position.value.y - collider.height;
+	area.width = width;
+	area.height = collider.height;
+	return true;
 }
 
 void Shield::end() {
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <vector>
+#include <chrono>
+
+#include "camera.hh"
+#include "render_queue.hh"
+
+// What the renderer needs from a simulation step, copied so drawing never touches the registry
+struct RenderSnapshot {
+	std::vector<DrawItem> items; // World draws, sorted
+	CameraState camera;
+	double time = 0.0; // When the step finished, in seconds of snapshot_clock()
+
+	// UI
+	bool has_player = false;
+	float player_health = 0.0; // From 0 to 1
+	bool show_help = false, player_died = false, player_won = false;
+};
+
+// Seconds on a steady clock both threads can read
+inline double snapshot_clock() {
+	return std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// Triple buffer, so the simulation always has a snapshot to write and the renderer always has the newest whole one
+class SnapshotBuffer {
+private:
+	static const int fresh = 4; // Set on the newest index until the renderer takes it
+
+	inline static std::array<RenderSnapshot, 3> snapshots;
+	inline static std::atomic<int> newest = 0;
+	inline static int writing = 1, reading = 2;
+
+public:
+	static RenderSnapshot& write() { return snapshots[writing]; } // Only used while holding the simulation
+	static void publish() { writing = newest.exchange(writing | fresh) & 3; }
+
+	// Only used by the renderer, stays the same until the next read
+	static const RenderSnapshot& read() {
+		if (newest.load() & fresh) reading = newest.exchange(reading) & 3;
+		return snapshots[reading];
+	}
+
+	SnapshotBuffer() = delete;
+};
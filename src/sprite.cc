@@ -1,5 +1,6 @@
 #include <toml.hpp>
 #include <iostream>
+#include <cmath>
 
 // The default range for Magic Enum is [-128, 128]
 #define MAGIC_ENUM_RANGE_MIN 0
@@ -15,8 +16,6 @@ Sprite::Sprite(std::string filename) {
 	length.fill(1);
 	offset.fill(0);
 
-	// Load the texture
-	texture = LoadTexture( &("assets/graphics/sprites/" + filename + ".png")[0] );
 	const auto data  = toml::parse("assets/graphics/sprites/" + filename + ".toml");
 
 	// Sprite properties
@@ -37,6 +36,46 @@ Sprite::Sprite(std::string filename) {
 		length[action] = toml::find<int>( file_lengths, action_name );
 		offset[action] = toml::find<int>( file_offsets, action_name );
 	}
+
+	// Trims written by working/sprite_sheet.py, by row then column of the sheet
+	std::vector< std::vector< std::vector<int> > > file_trims;
+	if ( data.contains("trim") ) file_trims = toml::find< std::vector< std::vector< std::vector<int> > > >(data, "trim", "rows");
+
+	// Add the frames each action can show to the atlas, the rest of the sheet is left out
+	Image sheet = LoadImage( &("assets/graphics/sprites/" + filename + ".png")[0] );
+	columns = sheet.width / width;
+	rows = sheet.height / height;
+	frames.assign( columns * rows, {} );
+
+	std::vector<bool> seen( columns * rows, false );
+	for (int action = IDLE; action < ACTION_COUNT; action++)
+	for (int row : { offset[action], offset[action] + direction_offset })
+	for (int column = 0; column < length[action]; column++) {
+		if (row < 0 || row >= rows || column >= columns) continue;
+		if ( seen[row * columns + column] ) continue;
+		seen[row * columns + column] = true;
+
+		SpriteFrame& frame = frames[row * columns + column];
+		if ( row < (int)file_trims.size() && column < (int)file_trims[row].size() && file_trims[row][column].size() == 4 ) {
+			const auto& t = file_trims[row][column];
+			frame.trim = { float(t[0]), float(t[1]), float(t[2]), float(t[3]) };
+		}
+		else frame.trim = find_trim(sheet, column, row);
+
+		// Only the opaque part goes in the atlas, so it takes less space and fills fewer pixels
+		if (frame.trim.width <= 0 || frame.trim.height <= 0) continue;
+		frame.image = Atlas::add( sheet, { column * width + frame.trim.x, row * height + frame.trim.y, frame.trim.width, frame.trim.height } );
+	}
+
+	UnloadImage(sheet);
+}
+
+Rectangle Sprite::find_trim(const Image& sheet, int column, int row) const {
+	Image cell = ImageFromImage( sheet, { float(column * width), float(row * height), float(width), float(height) } );
+	Rectangle trim = GetImageAlphaBorder(cell, 0.0);
+	UnloadImage(cell);
+
+	return trim;
 }
 
 void Sprite::render(float x, float y, const Action action, float timer, int direction, float rotation, float scale, Color color) {
@@ -44,22 +83,25 @@ void Sprite::render(float x, float y, const Action action, float timer, int dire
 	int off = 0;
 	if (direction == -1) off = direction_offset;
 
-	// Find the origin of the frame
-	float rx = int(timer*rate) % length[action] * width;
-	float ry = (offset[action] + off) * height;
+	// Find the frame
+	const int column = int(timer*rate) % length[action];
+	const int row = offset[action] + off;
+	if (column < 0 || row < 0 || column >= columns || row >= rows) return;
 
-	Rectangle source = {rx, ry, float(width), float(height)};
-	Rectangle dest = {float(x), float(y), float(width)*scale, float(height)*scale};
-	Vector2 origin = { float(width/2)*scale, float(height/2)*scale };
+	const SpriteFrame& frame = frames[row * columns + column];
+	if (frame.image < 0) return;
 
-	// texture.Draw(source, dest, origin, rotation);
-	DrawTexturePro(texture, source, dest, origin, rotation, color);
+	// Only the trimmed part is drawn, moved so it still turns around the centre of the cell
+	Rectangle dest = {float(x), float(y), frame.trim.width*scale, frame.trim.height*scale};
+	Vector2 origin = { (float(width/2) - frame.trim.x)*scale, (float(height/2) - frame.trim.y)*scale };
+
+	Atlas::queue(frame.image, dest, origin, rotation, color);
 }
 
-void Sprite::render(vec2 position, const Action action, float timer, int direction, float rotation, float scale, Color color) {
-	render(position.x, position.y, action, timer, direction, rotation, scale, color);
+float Sprite::radius(float scale) const {
+	return sqrt( float(width * width + height * height) ) * 0.5 * scale;
 }
 
-void Sprite::unload() {
-	UnloadTexture(texture);
+void Sprite::render(vec2 position, const Action action, float timer, int direction, float rotation, float scale, Color color) {
+	render(position.x, position.y, action, timer, direction, rotation, scale, color);
 }
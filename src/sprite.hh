@@ -4,9 +4,11 @@
 #include <string>
 #include <map>
 #include <memory>
+#include <vector>
 #include <raylib-cpp.hpp>
 
 #include "typedefs.hh"
+#include "atlas.hh"
 
 enum Action {
 	IDLE,
@@ -30,21 +32,29 @@ enum Action {
 	ACTION_COUNT
 };
 
+// A frame cut down to its opaque pixels
+struct SpriteFrame {
+	AtlasImage image = -1; // Unused and empty frames aren't in the atlas
+	Rectangle trim = {}; // Opaque part of the frame within its cell, the pivot stays at the cell's centre
+};
+
 class Sprite {
 private:
-	Texture2D texture;
+	std::vector<SpriteFrame> frames; // By row and column of the sheet
+	int columns, rows;
+
+	Rectangle find_trim(const Image& sheet, int column, int row) const; // Bounds of the opaque pixels in a cell
 
 public:
 	int rate; // Frame rate
-	int direction_offset;
+	int direction_offset = 0;
 	std::array<int, ACTION_COUNT> length; // Length of each action
 	std::array<int, ACTION_COUNT> offset; // Offset of each action
 	unsigned int width, height; // Size of sprite
 
 	void render(float x, float y, const Action action, float timer, int direction, float rotation=0.0, float scale=1.0, Color color=WHITE);
 	void render(vec2 position, const Action action, float timer, int direction, float rotation=0.0, float scale=1.0, Color color=WHITE);
-
-	void unload(); // Deletes the texture
+	float radius(float scale=1.0) const; // Furthest a frame reaches from its pivot at any rotation, for culling
 
 	Sprite(){}
 	Sprite(std::string filename);
@@ -3,6 +3,8 @@
 #include "typedefs.hh"
 #include "components.hh"
 
+struct RenderSnapshot;
+
 // Player actions
 void player_move(); // Gets movement input for player
 void player_jump();
@@ -11,9 +13,11 @@ void player_attack(); // Checks if player is attacking
 void player_bite(); // Checks if player is biting
 
 // Physics
+void store_positions(); // Saves positions for render interpolation
 void character_movement();
 void move_collide(); // Moves a body and applies collisions
 void gravity();
+void wake_bodies(); // Wakes sleeping bodies that were given a velocity
 void collider_overlap(); // Pushes colliders apart if they overlap
 
 // Combat
@@ -25,6 +29,7 @@ void bullets(); // Updates bullets
 void enemy_think();
 
 // General
+void update_activity(); // Puts entities far from the camera to sleep and wakes them when it gets close
 void camera_update();
 void particle_update();
 
@@ -38,12 +43,13 @@ void death_by_pitfall(); // Kills characters when they fall out of the map
 void render_colliders();
 void render_bullets();
 void render_collider_sprites();
-void render_game(raylib::Window& window);
+void render_game(const RenderSnapshot& snapshot); // Draws a snapshot on the main thread
+void publish_snapshot(); // Records what to draw after a step, on the simulation thread
 void animate_character();
 void render_particles();
 
 // UI Elements
-void health_bar();
+void health_bar(float health);
 void help_text();
 void death_text();
 void end_text();
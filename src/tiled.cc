@@ -0,0 +1,384 @@
+#include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdint>
+#include <cctype>
+#include <raylib-cpp.hpp>
+
+#ifdef BIOGOTH_ZSTD
+#include <zstd.h>
+#endif
+
+#include "tiled.hh"
+#include "jobs.hh"
+
+const uint32_t gid_mask = 0x0fffffff; // Removes the flip flags
+const uint32_t max_gid = 127; // Largest that fits in a Tile
+
+// Pulls values out of JSON text one at a time
+class JsonReader {
+private:
+	const char* at;
+	const char* end;
+
+public:
+	bool failed = false;
+
+	JsonReader(std::string_view text) : at( text.data() ), end( text.data() + text.size() ) {}
+
+	void fail() {
+		failed = true;
+		at = end;
+	}
+
+	char peek() {
+		while ( at < end && (*at == ' ' || *at == '\n' || *at == '\r' || *at == '\t') ) at++;
+		return at < end ? *at : '\0';
+	}
+
+	bool consume(char c) {
+		if ( peek() != c ) return false;
+		at++;
+		return true;
+	}
+
+	void expect(char c) {
+		if ( !consume(c) ) fail();
+	}
+
+	std::string_view raw_string() { // Contents of a string with escapes left in
+		expect('"');
+		const char* start = at;
+		while (at < end && *at != '"') at += (*at == '\\') ? 2 : 1;
+		if (at >= end) {
+			fail();
+			return {};
+		}
+
+		return std::string_view( start, (at++) - start );
+	}
+
+	std::string string() {
+		std::string_view raw = raw_string();
+		std::string text;
+		text.reserve( raw.size() );
+
+		for (size_t i = 0; i < raw.size(); i++) {
+			if (raw[i] != '\\' || i + 1 == raw.size()) {
+				text += raw[i];
+				continue;
+			}
+
+			switch (raw[++i]) {
+				case 'n': text += '\n'; break;
+				case 't': text += '\t'; break;
+				case 'u': text += '?'; i += 4; break; // Names are expected to be plain text
+				default: text += raw[i];
+			}
+		}
+
+		return text;
+	}
+
+	double number() {
+		peek();
+		char* number_end;
+		double value = strtod(at, &number_end);
+		if (number_end == at) fail();
+		else at = number_end;
+		return value;
+	}
+
+	bool boolean() {
+		if ( peek() == 't' && end - at >= 4 ) {
+			at += 4;
+			return true;
+		}
+		if ( peek() == 'f' && end - at >= 5 ) {
+			at += 5;
+			return false;
+		}
+
+		fail();
+		return false;
+	}
+
+	void skip() { // Skips over any value
+		switch ( peek() ) {
+			case '{': object( [&](std::string_view) { skip(); } ); break;
+			case '[': array( [&]() { skip(); } ); break;
+			case '"': raw_string(); break;
+			case 't': case 'f': boolean(); break;
+			case 'n': at = std::min(at + 4, end); break;
+			default: number();
+		}
+	}
+
+	template<class Function>
+	void object(Function on_key) { // Calls on_key for each key, which has to read the value
+		expect('{');
+		if ( consume('}') ) return;
+
+		do {
+			std::string_view key = raw_string();
+			expect(':');
+			on_key(key);
+		} while ( !failed && consume(',') );
+
+		expect('}');
+	}
+
+	template<class Function>
+	void array(Function on_item) {
+		expect('[');
+		if ( consume(']') ) return;
+
+		do on_item();
+		while ( !failed && consume(',') );
+
+		expect(']');
+	}
+};
+
+// Tiled colors are #RRGGBB or #AARRGGBB
+static rgba parse_color(std::string text) {
+	if ( !text.empty() && text[0] == '#' ) text.erase(0, 1);
+
+	unsigned int value = strtoul(text.c_str(), nullptr, 16);
+	unsigned char alpha = text.size() == 8 ? value >> 24 : 255;
+	rgba color( (value >> 16) & 255, (value >> 8) & 255, value & 255, alpha );
+
+	if (color.r == 0 && color.g == 0 && color.b == 0 && color.a == 255) return WHITE; // Black means no tint
+	return color;
+}
+
+static void read_layer(JsonReader& json, TiledMap& map) {
+	TiledLayer layer;
+	std::string type;
+	std::vector<TiledObject> objects;
+
+	json.object( [&](std::string_view key) {
+		if (key == "type") type = json.string();
+		else if (key == "name") layer.name = json.string();
+		else if (key == "width") layer.info.width = json.number();
+		else if (key == "height") layer.info.height = json.number();
+		else if (key == "parallaxx") layer.info.parallax.x = json.number();
+		else if (key == "parallaxy") layer.info.parallax.y = json.number();
+		else if (key == "offsetx") layer.info.offset.x = json.number();
+		else if (key == "offsety") layer.info.offset.y = json.number();
+		else if (key == "repeatx") layer.info.repeat_x = json.boolean();
+		else if (key == "repeaty") layer.info.repeat_y = json.boolean();
+		else if (key == "tintcolor") layer.info.tint = parse_color( json.string() );
+		else if (key == "image") layer.info.image = json.string();
+		else if (key == "encoding") layer.encoding = json.string();
+		else if (key == "compression") layer.compression = json.string();
+		else if (key == "data") {
+			// Plain arrays are read straight into the tiles, encoded data is decoded later
+			if ( json.peek() == '"' ) layer.data = json.raw_string();
+			else json.array( [&]() {
+				const uint32_t gid = uint32_t( json.number() ) & gid_mask;
+				layer.largest_gid = std::max(layer.largest_gid, gid);
+				layer.tiles.push_back(gid);
+			} );
+		}
+		else if (key == "properties") {
+			json.array( [&]() {
+				std::string name;
+				double value = 0.0;
+				json.object( [&](std::string_view property_key) {
+					if (property_key == "name") name = json.string();
+					else if ( property_key == "value" && ( isdigit( json.peek() ) || json.peek() == '-' ) ) value = json.number();
+					else json.skip();
+				} );
+
+				if (name == "Scroll Speed X") layer.info.scroll_speed.x = value;
+				if (name == "Scroll Speed Y") layer.info.scroll_speed.y = value;
+			} );
+		}
+		else if (key == "objects") {
+			json.array( [&]() {
+				TiledObject object = {0.0, 0.0, ""};
+				json.object( [&](std::string_view object_key) {
+					if (object_key == "x") object.x = int( json.number() );
+					else if (object_key == "y") object.y = int( json.number() );
+					else if (object_key == "type" || object_key == "class") object.type = json.string();
+					else json.skip();
+				} );
+				objects.push_back(object);
+			} );
+		}
+		else json.skip();
+	} );
+
+	if (type == "objectgroup") {
+		map.objects.insert( map.objects.end(), objects.begin(), objects.end() );
+		return;
+	}
+
+	if (type == "imagelayer") layer.info.type = LayerType::IMAGE;
+	else if (type == "tilelayer") layer.info.type = LayerType::TILE;
+	else return;
+
+	if (layer.name == "Main") map.main_layer = map.layers.size();
+	map.layers.push_back( std::move(layer) );
+}
+
+static void read_tileset(JsonReader& json, TiledMap& map) {
+	TiledTileset tileset;
+
+	json.object( [&](std::string_view key) {
+		if (key == "firstgid") tileset.first_gid = json.number();
+		else if (key == "columns") tileset.columns = json.number();
+		else if (key == "tilewidth") tileset.tile_width = json.number();
+		else if (key == "tileheight") tileset.tile_height = json.number();
+		else if (key == "margin") tileset.margin = json.number();
+		else if (key == "spacing") tileset.spacing = json.number();
+		else if (key == "image") tileset.image = json.string();
+		else json.skip();
+	} );
+
+	map.tilesets.push_back(tileset);
+}
+
+static std::vector<unsigned char> decode_base64(std::string_view text) {
+	std::vector<unsigned char> bytes;
+	bytes.reserve( text.size() * 3 / 4 );
+
+	uint32_t buffer = 0;
+	int bits = 0;
+
+	for (char c : text) {
+		int value;
+		if (c >= 'A' && c <= 'Z') value = c - 'A';
+		else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+		else if (c >= '0' && c <= '9') value = c - '0' + 52;
+		else if (c == '+') value = 62;
+		else if (c == '/') value = 63;
+		else if (c == '=') break;
+		else continue; // Skips JSON escapes and whitespace
+
+		buffer = (buffer << 6) | value;
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			bytes.push_back( (buffer >> bits) & 255 );
+		}
+	}
+
+	return bytes;
+}
+
+static bool inflate(std::vector<unsigned char>& bytes, size_t header_size) {
+	if ( bytes.size() <= header_size ) return false;
+
+	int length = 0;
+	unsigned char* data = DecompressData( bytes.data() + header_size, bytes.size() - header_size, &length );
+	if (data == nullptr) return false;
+
+	bytes.assign(data, data + length);
+	MemFree(data);
+	return true;
+}
+
+static size_t gzip_header_size(const std::vector<unsigned char>& bytes) {
+	if ( bytes.size() < 10 || bytes[0] != 0x1f || bytes[1] != 0x8b ) return bytes.size();
+
+	const unsigned char flags = bytes[3];
+	size_t size = 10;
+
+	if ( flags & 4 && size + 2 <= bytes.size() ) size += 2 + ( bytes[size] | bytes[size + 1] << 8 ); // Extra field
+	if ( flags & 8 ) while ( size < bytes.size() && bytes[size++] != 0 ); // File name
+	if ( flags & 16 ) while ( size < bytes.size() && bytes[size++] != 0 ); // Comment
+	if ( flags & 2 ) size += 2; // Header checksum
+
+	return size;
+}
+
+static bool decode_layer(TiledLayer& layer) {
+	if ( layer.info.type != LayerType::TILE ) return true;
+
+	if ( !layer.encoding.empty() ) {
+		if (layer.encoding != "base64") {
+			std::cerr << layer.name << ": unknown encoding " << layer.encoding << "\n";
+			return false;
+		}
+
+		std::vector<unsigned char> bytes = decode_base64(layer.data);
+
+		bool decoded = true;
+		if ( layer.compression == "zlib" ) decoded = inflate(bytes, 2); // Skip the zlib header
+		else if ( layer.compression == "gzip" ) decoded = inflate( bytes, gzip_header_size(bytes) );
+		else if ( layer.compression == "zstd" ) {
+#ifdef BIOGOTH_ZSTD
+			std::vector<unsigned char> output( size_t(layer.info.width) * layer.info.height * 4 );
+			size_t length = ZSTD_decompress( output.data(), output.size(), bytes.data(), bytes.size() );
+			decoded = !ZSTD_isError(length) && length == output.size();
+			bytes = std::move(output);
+#else
+			std::cerr << layer.name << ": zstd layers need a build with BIOGOTH_ZSTD\n";
+			decoded = false;
+#endif
+		}
+		else if ( !layer.compression.empty() ) decoded = false;
+
+		if (!decoded) {
+			std::cerr << layer.name << ": could not decompress " << layer.compression << " data\n";
+			return false;
+		}
+
+		// Global tile IDs are little endian 32 bit numbers
+		layer.tiles.resize( bytes.size() / 4 );
+		for (size_t i = 0; i < layer.tiles.size(); i++) {
+			const unsigned char* bytes_le = &bytes[i * 4];
+			const uint32_t gid = ( bytes_le[0] | bytes_le[1] << 8 | bytes_le[2] << 16 | uint32_t(bytes_le[3]) << 24 ) & gid_mask;
+			layer.largest_gid = std::max(layer.largest_gid, gid);
+			layer.tiles[i] = gid;
+		}
+	}
+
+	if ( layer.largest_gid > max_gid ) {
+		std::cerr << layer.name << ": uses tile " << layer.largest_gid << ", only " << max_gid << " tiles fit in a layer\n";
+		return false;
+	}
+
+	if ( layer.tiles.size() != size_t(layer.info.width) * layer.info.height ) {
+		std::cerr << layer.name << ": has " << layer.tiles.size() << " tiles, expected " << layer.info.width * layer.info.height << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+bool load_tiled_map(const std::string filename, TiledMap& map) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) return false;
+
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	const std::string text = buffer.str();
+
+	JsonReader json(text);
+	json.object( [&](std::string_view key) {
+		if (key == "layers") json.array( [&]() { read_layer(json, map); } );
+		else if (key == "tilesets") json.array( [&]() { read_tileset(json, map); } );
+		else if (key == "tilewidth") map.tile_size = json.number();
+		else json.skip();
+	} );
+
+	if (json.failed) {
+		std::cerr << filename << ": could not read JSON\n";
+		return false;
+	}
+
+	// Decode each layer on its own job
+	std::vector<char> decoded( map.layers.size() );
+	JobSystem::parallel_for( map.layers.size(), 1, [&](size_t start, size_t end) {
+		for (size_t i = start; i < end; i++) decoded[i] = decode_layer( map.layers[i] );
+	} );
+
+	for (auto& layer : map.layers) layer.data = {}; // The text is about to be freed
+
+	return std::find( decoded.begin(), decoded.end(), false ) == decoded.end();
+}
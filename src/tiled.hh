@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tilemap.hh"
+
+// Tiled JSON map read without building a document, only what Tilemap uses is kept
+struct TiledTileset {
+	int first_gid = 1;
+	int columns = 1;
+	int tile_width = 32, tile_height = 32;
+	int margin = 0, spacing = 0;
+	std::string image;
+};
+
+struct TiledObject {
+	float x, y;
+	std::string type;
+};
+
+struct TiledLayer {
+	LayerInfo info;
+	std::string name;
+	std::string encoding, compression; // Empty for plain arrays
+	std::string_view data; // Encoded tiles, points into the file text until decoded
+	std::vector<Tile> tiles;
+	uint32_t largest_gid = 0; // Before narrowing into tiles, so ones too big to store are caught
+};
+
+struct TiledMap {
+	int tile_size = 32;
+	int main_layer = 0;
+	std::vector<TiledLayer> layers; // Tile and image layers in drawing order
+	std::vector<TiledTileset> tilesets;
+	std::vector<TiledObject> objects;
+};
+
+bool load_tiled_map(const std::string filename, TiledMap& map); // Layer data is decoded on the job system
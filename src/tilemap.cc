@@ -1,47 +1,344 @@
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 #include <iostream>
-#include <tileson.hpp>
+#include <map>
 #include <raylib-cpp.hpp>
+#include <rlgl.h>
 
 #include "globals.hh"
 #include "tilemap.hh"
 #include "entities.hh"
 #include "camera.hh"
+#include "mapped_file.hh"
+#include "tiled.hh"
+#include "jobs.hh"
+#include "renderer.hh"
+#include "viewport.hh"
+#include "decals.hh"
+
+// Cooked level file layout, written by working/cook_level.py
+struct CookedHeader {
+	char magic[4];
+	uint32_t version;
+	int32_t width, height, tile_size;
+	uint32_t main_layer;
+	uint32_t layer_count, layers; // Offsets are in bytes from the start of the file
+	uint32_t spawn_count, spawns;
+	uint32_t solid_mask; // Laid out like Tilemap::solid_mask
+};
+
+struct CookedLayer {
+	uint32_t type;
+	float parallax_x, parallax_y;
+	float offset_x, offset_y;
+	float scroll_x, scroll_y;
+	uint8_t tint[4];
+	uint32_t repeat_x, repeat_y;
+	int32_t width, height;
+	uint32_t image; // Image path relative to the level
+	uint32_t bricks; // Tile layers only, see MapLayer::bricks
+	uint32_t brick_pool; // Bricks of each block start on a new page
+	uint32_t rects, rect_count;
+};
+
+struct CookedSpawn {
+	float x, y;
+	uint32_t type; // Entity type name
+};
+
+static_assert(sizeof(CookedHeader) == 44 && sizeof(CookedLayer) == 68 && sizeof(CookedSpawn) == 12);
+static_assert(sizeof(Rectangle) == 16);
+
+const uint32_t cooked_version = 3;
+const float spawn_margin = 640.0; // Distance outside the view where objects are spawned
+
+// Loads each image once, so restarting doesn't read them again
+static Texture2D load_texture_cached(const std::string path, bool* opaque = nullptr) {
+	struct CachedTexture {
+		Texture2D texture;
+		bool opaque; // Every pixel is fully opaque
+	};
+
+	static std::map<std::string, CachedTexture> textures;
+
+	auto found = textures.find(path);
+	if ( found == textures.end() ) {
+		Image image = LoadImage( path.c_str() );
+
+		bool image_opaque = image.data != nullptr;
+		if (image_opaque) {
+			Color* colors = LoadImageColors(image);
+			image_opaque = std::all_of( colors, colors + image.width * image.height, [](Color c) { return c.a == 255; } );
+			UnloadImageColors(colors);
+		}
+
+		// Without a GPU the texture only needs an id and size, so draws can still be counted
+		Texture2D texture = Renderer::has_gpu() ? LoadTextureFromImage(image) : Renderer::placeholder_texture(image.width, image.height);
+		found = textures.emplace( path, CachedTexture{ texture, image_opaque } ).first;
+		UnloadImage(image);
+	}
+
+	if (opaque) *opaque = found->second.opaque;
+	return found->second.texture;
+}
+
+// The part of the world on screen, the camera is scaled to the viewport
+static Rectangle screen_area() {
+	const Camera2D& camera = CameraSystem::get_camera();
+	const float z = 1 / camera.zoom;
+
+	return {
+		camera.target.x - float(Viewport::get_width() / 2) * z,
+		camera.target.y - float(Viewport::get_height() / 2) * z,
+		(float)Viewport::get_width() * z,
+		(float)Viewport::get_height() * z
+	};
+}
+
+static bool same_rect(const Rectangle& a, const Rectangle& b) {
+	return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
 
 Tilemap::Tilemap(const std::string filename) {
-	// FileData map_file_data = File::open(filename);
+	const bool loaded = IsFileExtension( filename.c_str(), ".lvl" ) ? load_cooked(filename) : load_json(filename);
+
+	if (!loaded) {
+		std::cerr << "Failed to load level " << filename << '\n';
+
+		// Leave an empty map, so collision and spawn queries stay in bounds
+		layers.clear();
+		main_layer = 0;
+		width = 0;
+		height = 0;
+		build_solid_mask();
+		setup_spawns();
+		Decals::clear();
+		return;
+	}
+
+	Decals::init(width, height, tile_size); // Decals line up with the main layer
+}
+
+bool Tilemap::load_cooked(const std::string filename) {
+	auto file = std::make_shared<const MappedFile>(filename);
+	if ( !file->is_open() || file->size() < sizeof(CookedHeader) ) {
+		std::cerr << filename << " couldn't be opened or is too short\n";
+		return false;
+	}
+
+	const unsigned char* bytes = file->data();
+	const size_t size = file->size();
+	const auto& header = *(const CookedHeader*)bytes;
+
+	if ( std::string(header.magic, 4) != "BLVL" || header.version != cooked_version ) {
+		std::cerr << filename << " is not a cooked level or is out of date\n";
+		return false;
+	}
+
+	// Make sure every table fits in the file
+	auto fits = [&](size_t offset, size_t length) { return offset <= size && length <= size - offset; };
+	auto corrupt = [&](const char* part) {
+		std::cerr << filename << " has a broken " << part << '\n';
+		return false;
+	};
+	auto has_string = [&](uint32_t offset) { return offset < size && memchr(bytes + offset, '\0', size - offset) != nullptr; };
 
-	tson::Tileson t;
-	std::unique_ptr<tson::Map> map = t.parse( fs::path(filename) );
+	if ( !fits(header.layers, header.layer_count * sizeof(CookedLayer)) ) return corrupt("layer table");
+	if ( !fits(header.spawns, header.spawn_count * sizeof(CookedSpawn)) ) return corrupt("spawn table");
+	if ( header.main_layer >= header.layer_count ) return corrupt("main layer index");
 
-	if (map->getStatus() != tson::ParseStatus::OK) return;
+	const int mask_words = ( (header.width + 2 + 7) / 8 ) * ( (header.height + 2 + 7) / 8 );
+	if ( !fits(header.solid_mask, mask_words * sizeof(uint64_t)) ) return corrupt("solid mask");
 
-	// Loop over layers
-	auto file_layers = map->getLayers();
-	for (auto layer = file_layers.begin(); layer != file_layers.end(); ++layer) {
-		// Check if the map is a tile or image map
-		if ( layer->getType() != tson::LayerType::TileLayer && layer->getType() != tson::LayerType::ImageLayer )
+	const auto* file_layers = (const CookedLayer*)(bytes + header.layers);
+	for (uint32_t i = 0; i < header.layer_count; i++) {
+		const CookedLayer& layer = file_layers[i];
+		if ( !has_string(layer.image) ) return corrupt("image path");
+		if ( layer.type != 0 ) continue;
+
+		const size_t brick_count = size_t( (layer.width + brick_size - 1) / brick_size ) * ( (layer.height + brick_size - 1) / brick_size );
+		if ( !fits(layer.bricks, brick_count * sizeof(uint32_t)) || !fits(layer.rects, layer.rect_count * sizeof(Rectangle)) ) return corrupt("tile layer");
+
+		// Tiles index the layer's rects when chunks are baked
+		auto valid_tile = [&](unsigned char t) { return t == empty_tile || ( t <= 127 && t < layer.rect_count ); };
+
+		const auto* bricks = (const uint32_t*)(bytes + layer.bricks);
+		for (size_t b = 0; b < brick_count; b++) {
+			if (bricks[b] & brick_fill) {
+				if ( !valid_tile(bricks[b] & 0xff) ) return corrupt("brick");
+				continue;
+			}
+
+			const size_t offset = size_t(layer.brick_pool) + size_t(bricks[b]) * brick_area;
+			if ( !fits(offset, brick_area) || !std::all_of(bytes + offset, bytes + offset + brick_area, valid_tile) ) return corrupt("brick");
+		}
+	}
+
+	auto map_path = filename.substr( 0, filename.find_last_of("\\/")+1 );
+	for (uint32_t i = 0; i < header.layer_count; i++) {
+		const CookedLayer& layer = file_layers[i];
+
+		LayerInfo info;
+		info.type = layer.type == 0 ? LayerType::TILE : LayerType::IMAGE;
+		info.parallax = vec2(layer.parallax_x, layer.parallax_y);
+		info.offset = vec2(layer.offset_x, layer.offset_y);
+		info.scroll_speed = vec2(layer.scroll_x, layer.scroll_y);
+		info.tint = rgba(layer.tint[0], layer.tint[1], layer.tint[2], layer.tint[3]);
+		info.repeat_x = layer.repeat_x;
+		info.repeat_y = layer.repeat_y;
+		info.width = layer.width;
+		info.height = layer.height;
+		info.image = map_path + (const char*)(bytes + layer.image);
+
+		if (info.type == LayerType::IMAGE) {
+			layers.push_back( MapLayer(info) );
+			continue;
+		}
+
+		// Use the arrays straight from the file, the layer keeps the file open
+		layers.push_back( MapLayer( info, std::shared_ptr<const Rectangle[]>( file, (const Rectangle*)(bytes + layer.rects) ) ) );
+		layers.back().map_tiles( file, (const uint32_t*)(bytes + layer.bricks), (const Tile*)(bytes + layer.brick_pool) );
+	}
+
+	main_layer = header.main_layer;
+	tile_size = header.tile_size;
+	width = header.width;
+	height = header.height;
+
+	// The mask is cooked so loading doesn't read every tile
+	mask_stride = (width + 2 + 7) / 8;
+	const auto* mask = (const uint64_t*)(bytes + header.solid_mask);
+	solid_mask.assign(mask, mask + mask_words);
+
+	setup_spawns();
+	const auto* file_spawns = (const CookedSpawn*)(bytes + header.spawns);
+	for (uint32_t i = 0; i < header.spawn_count; i++) {
+		if ( !has_string(file_spawns[i].type) ) continue;
+		add_spawn( (const char*)(bytes + file_spawns[i].type), {file_spawns[i].x, file_spawns[i].y} );
+	}
+
+	return true;
+}
+
+bool Tilemap::load_json(const std::string filename) {
+	TiledMap map;
+	if ( !load_tiled_map(filename, map) ) return false;
+
+	auto map_path = filename.substr( 0, filename.find_last_of("\\/")+1 );
+
+	for (auto& file_layer : map.layers) {
+		LayerInfo& info = file_layer.info;
+		if (info.type == LayerType::IMAGE) {
+			info.image = map_path + info.image;
+			layers.push_back( MapLayer(info) );
 			continue;
+		}
+
+		if ( file_layer.tiles.empty() ) {
+			std::cerr << filename << ": layer " << layers.size() << " has no tiles\n";
+			return false;
+		}
+
+		// Find the tileset of the first tile, layers only use one
+		auto first = std::find_if( file_layer.tiles.begin(), file_layer.tiles.end(), [](Tile t) { return t != empty_tile; } );
+		const Tile first_tile = first != file_layer.tiles.end() ? *first : 1;
+		const TiledTileset* tileset = nullptr;
+		for (const auto& candidate : map.tilesets)
+			if (candidate.first_gid <= first_tile && ( !tileset || candidate.first_gid > tileset->first_gid )) tileset = &candidate;
+
+		if (!tileset) {
+			std::cerr << filename << ": layer " << layers.size() << " uses a tile from no tileset\n";
+			return false; // Skipping it would put the layers after it out of place
+		}
+		info.image = map_path + tileset->image;
+
+		// Work out the drawing rect of each tile
+		const Tile last_tile = *std::max_element( file_layer.tiles.begin(), file_layer.tiles.end() );
+		auto rects = std::make_shared< std::vector<Rectangle> >( std::max(int(last_tile), 0) + 1 );
+		for (int gid = tileset->first_gid; gid <= last_tile; gid++) {
+			const int index = gid - tileset->first_gid;
+			(*rects)[gid] = {
+				float( tileset->margin + (index % tileset->columns) * (tileset->tile_width + tileset->spacing) ),
+				float( tileset->margin + (index / tileset->columns) * (tileset->tile_height + tileset->spacing) ),
+				float(tileset->tile_width),
+				float(tileset->tile_height)
+			};
+		}
 
-		layers.push_back( MapLayer(filename, *layer) ); // Add the layer to the map
+		layers.push_back( MapLayer( info, std::shared_ptr<const Rectangle[]>( rects, rects->data() ) ) );
+		layers.back().set_tiles(file_layer.tiles);
+	}
 
-		// If the layer is named "Main" then set its index as the main layer
-		if ( layer->getName() == "Main" )
-			main_layer = std::distance( file_layers.begin(), layer );
+	if ( map.main_layer < 0 || map.main_layer >= (int)layers.size() ) {
+		std::cerr << filename << " has no layers\n";
+		return false;
 	}
 
+	main_layer = map.main_layer;
+	tile_size = map.tile_size;
 	width = layers[main_layer].width;
 	height = layers[main_layer].height;
+	build_solid_mask();
+
+	setup_spawns();
+	for (const auto& object : map.objects) add_spawn( object.type, {object.x, object.y} );
+
+	return true;
+}
+
+void Tilemap::setup_spawns() {
+	spawn_chunks_x = (width + chunk_size - 1) / chunk_size;
+	spawn_chunks_y = (height + chunk_size - 1) / chunk_size;
+	spawns.assign( spawn_chunks_x * spawn_chunks_y, {} );
+	spawned.assign( spawn_chunks_x * spawn_chunks_y, false );
+}
+
+void Tilemap::add_spawn(const std::string type, vec2 position) {
+	// The player is needed straight away
+	if (type == "player") {
+		spawn_entity(type, position);
+		return;
+	}
+
+	const float chunk_pixels = chunk_size * tile_size;
+	const int x = std::clamp( (int)floor(position.x / chunk_pixels), 0, spawn_chunks_x - 1 );
+	const int y = std::clamp( (int)floor(position.y / chunk_pixels), 0, spawn_chunks_y - 1 );
+	spawns[y * spawn_chunks_x + x].push_back( {type, position} );
+}
+
+void Tilemap::spawn_objects(raylib::Rectangle area) {
+	const float chunk_pixels = chunk_size * tile_size;
 
-	// Get the object layer
-	tson::Layer* object_layer = map->getLayer("Objects");
-	if (object_layer->getType() != tson::LayerType::ObjectGroup) return;
+	const int start_x = std::max( (int)floor( (area.x - spawn_margin) / chunk_pixels ), 0 );
+	const int start_y = std::max( (int)floor( (area.y - spawn_margin) / chunk_pixels ), 0 );
+	const int end_x = std::min( (int)floor( (area.x + area.width + spawn_margin) / chunk_pixels ), spawn_chunks_x - 1 );
+	const int end_y = std::min( (int)floor( (area.y + area.height + spawn_margin) / chunk_pixels ), spawn_chunks_y - 1 );
 
-	for ( auto& object : object_layer->getObjects() ) {
-		tson::Vector2i position = object.getPosition();
-		std::string type = object.getType();
+	for (int y = start_y; y <= end_y; y++)
+	for (int x = start_x; x <= end_x; x++) {
+		const int i = y * spawn_chunks_x + x;
+		if ( spawned[i] ) continue;
 
-		spawn_entity(type, {(float)position.x, (float)position.y});
+		// Entities are never despawned, they go dormant when the camera leaves
+		for (const auto& spawn : spawns[i]) spawn_entity(spawn.type, spawn.position);
+		spawned[i] = true;
+		spawns[i].clear();
+	}
+}
+
+void Tilemap::build_solid_mask() {
+	mask_stride = (width + 2 + 7) / 8;
+	solid_mask.assign( mask_stride * ( (height + 2 + 7) / 8 ), 0 );
+
+	for (int y = 0; y < height; y++)
+	for (int x = 0; x < width; x++) {
+		if ( layers[main_layer](x, y) == empty_tile ) continue;
+
+		// Skip the border
+		const int mask_x = x + 1;
+		const int mask_y = y + 1;
+		solid_mask[ (mask_y / 8) * mask_stride + mask_x / 8 ] |= uint64_t(1) << ( (mask_y % 8) * 8 + mask_x % 8 );
 	}
 }
 
@@ -58,7 +355,102 @@ TileCoord Tilemap::tile_coord(const int i) const {
 }
 
 void Tilemap::draw() {
-	for (auto& layer : layers) layer.draw();
+	for (int i = first_layer; i < (int)layers.size(); i++) {
+		if ( i >= (int)layer_caches.size() || layer_caches[i].count == 0 ) {
+			layers[i].draw();
+			if (i == main_layer) Decals::draw(); // Marks on the level go on top of its tiles
+			continue;
+		}
+
+		const LayerCache& cache = layer_caches[i];
+
+		// The cache holds premultiplied colour
+		Renderer::blend_mode(BLEND_ALPHA_PREMULTIPLY);
+		Renderer::texture(
+			cache.target.texture,
+			{ 0, 0, (float)cache.target.texture.width, -(float)cache.target.texture.height },
+			screen_area(),
+			{ 0, 0 },
+			0,
+			WHITE
+		);
+		Renderer::blend_mode(BLEND_ALPHA);
+
+		i += cache.count - 1;
+	}
+}
+
+void Tilemap::prepare() {
+	frame++;
+	for (auto& layer : layers) layer.prepare(frame);
+	Decals::prepare();
+	composite_layers();
+}
+
+void Tilemap::composite_layers() {
+	layer_caches.resize( layers.size() );
+
+	// An opaque image covers the whole screen, so nothing behind it is seen
+	first_layer = 0;
+	for (int i = 0; i < (int)layers.size(); i++)
+		if ( layers[i].is_opaque() ) first_layer = i;
+
+	for (auto& cache : layer_caches) cache.count = 0;
+	if ( !Renderer::has_gpu() ) return; // Caches are render textures
+
+	// Find runs of image layers that haven't moved, a run of one is drawn straight away
+	for (int i = first_layer; i < (int)layers.size(); i++) {
+		int end = i;
+		while ( end < (int)layers.size() && layers[end].is_still() ) end++;
+		if (end - i < 2) continue;
+
+		layer_caches[i].count = end - i;
+		update_cache(layer_caches[i], i);
+		i = end - 1;
+	}
+}
+
+void Tilemap::update_cache(LayerCache& cache, int first) {
+	// Caches are drawn at the same resolution as the rest of the world
+	const int width = Viewport::get_width();
+	const int height = Viewport::get_height();
+	const bool resized = cache.target.texture.width != width || cache.target.texture.height != height;
+
+	// Only draw the cache again when its layers are somewhere new
+	bool moved = resized || (int)cache.sources.size() != cache.count;
+	for (int i = 0; i < cache.count && !moved; i++)
+		moved = !same_rect( cache.sources[i], layers[first + i].image_source() );
+
+	if (!moved) return;
+
+	if (resized) {
+		if (cache.target.id != 0) UnloadRenderTexture(cache.target);
+		cache.target = LoadRenderTexture(width, height);
+	}
+
+	cache.sources.clear();
+	for (int i = first; i < first + cache.count; i++) cache.sources.push_back( layers[i].image_source() );
+
+	// Blend colour as usual but keep it premultiplied, so drawing the cache matches drawing each layer
+	BeginTextureMode(cache.target);
+	ClearBackground(BLANK);
+	rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+	BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+
+	for (int i = first; i < first + cache.count; i++)
+		layers[i].composite( { 0, 0, (float)width, (float)height } );
+
+	EndBlendMode();
+	EndTextureMode();
+}
+
+void Tilemap::unload() {
+	for (auto& layer : layers) layer.unload();
+	Decals::unload();
+
+	for (auto& cache : layer_caches)
+		if (cache.target.id != 0) UnloadRenderTexture(cache.target);
+	layer_caches.clear();
 }
 
 TileCoord Tilemap::world_to_tile(const Vector2 position) const { // Gets the tile coordinate from world coordinate
@@ -108,35 +500,31 @@ Tile Tilemap::operator()(const TileCoord t) const {
 }
 
 void MapLayer::draw_tile() const {
-	// Find what range of tiles are on the screen
-	vec2 min_corner = CameraSystem::get_camera().GetScreenToWorld({0.0, 0.0});
-	vec2 max_corner = CameraSystem::get_camera().GetScreenToWorld({(float)screen_width, (float)screen_height});
+	TileCoord start, end;
+	visible_chunks(start, end);
 
-	TileCoord start_coord = tilemap.world_to_tile(min_corner);
-	TileCoord end_coord = tilemap.world_to_tile(max_corner);
+	const vec2 shift = layer_shift();
+	const float chunk_pixels = chunk_size * tile_size;
 
-	// Prevent tiles out of bounds being drawn
-	start_coord.x = std::max(start_coord.x, 0);
-	start_coord.y = std::max(start_coord.y, 0);
+	for (int y = start.y; y <= end.y; y++)
+	for (int x = start.x; x <= end.x; x++) {
+		const TileChunk& chunk = chunks[y * chunks_x + x];
+		if (chunk.empty) continue;
 
-	end_coord.x = std::min(end_coord.x, width - 1);
-	end_coord.y = std::min(end_coord.y, height - 1);
-
-	for (int y = start_coord.y; y < end_coord.y + 1; y++)
-	for (int x = start_coord.x; x < end_coord.x + 1; x++) {
-		const Tile& t = tiles[ tile_index(x, y) ];
-		if (t == empty_tile) continue;
+		const Texture2D& baked = chunk.lods[lod].texture;
+		if ( baked.id == 0 && Renderer::has_gpu() ) continue; // Not baked yet, headless runs count the draw anyway
 
 		Rectangle dest = {
-			offset.x + (parallax.x * CameraSystem::get_camera().target.x) + (x * tile_size),
-			offset.y + (parallax.y * CameraSystem::get_camera().target.y) + (y * tile_size),
-			float(tile_size),
-			float(tile_size)
+			shift.x + x * chunk_pixels,
+			shift.y + y * chunk_pixels,
+			chunk_pixels,
+			chunk_pixels
 		};
 
-		DrawTexturePro(
-			texture,
-			rects[t],
+		// Render textures are stored upside down
+		Renderer::texture(
+			baked,
+			{0.0, 0.0, (float)baked.width, -(float)baked.height},
 			dest,
 			{0.0, 0.0},
 			0.0,
@@ -145,126 +533,351 @@ void MapLayer::draw_tile() const {
 	}
 }
 
-void MapLayer::draw_image() const {
-	const float z = 1 / CameraSystem::get_camera().zoom;
-	Vector2 origin = {
-		CameraSystem::get_camera().target.x - float(GetScreenWidth() / 2) * z,
-		CameraSystem::get_camera().target.y - float(GetScreenHeight() / 2) * z
-	};
-
-	Rectangle source = {
-		(parallax.x * origin.x) + offset.x,
-		(parallax.y * origin.y) - offset.y,
-		(float)GetScreenWidth(),
-		(float)GetScreenHeight()
-	};
+void MapLayer::setup_bricks() {
+	bricks_x = (width + brick_size - 1) / brick_size;
+	bricks_y = (height + brick_size - 1) / brick_size;
 
-	Rectangle dest = {
-		origin.x,
-		origin.y,
-		(float)GetScreenWidth() * z,
-		(float)GetScreenHeight() * z
-	};
+	chunks_x = (width + chunk_size - 1) / chunk_size;
+	chunks_y = (height + chunk_size - 1) / chunk_size;
+	chunks.assign( chunks_x * chunks_y, TileChunk() );
 
-	DrawTexturePro(
-		texture,
-		source,
-		dest,
-		(Vector2) { 0, 0 },
-		0,
-		tint
-	);
+	blocks_x = (width + block_size - 1) / block_size;
+	blocks_y = (height + block_size - 1) / block_size;
+	blocks.assign( blocks_x * blocks_y, TileBlock() );
 }
 
-MapLayer::MapLayer(const std::string filename, tson::Layer& layer) {
-	auto map_path = filename.substr( 0, filename.find_last_of("\\/")+1 );
+// Bricks and their pool, for levels that aren't cooked
+struct BrickStorage {
+	std::vector<uint32_t> bricks;
+	std::vector<Tile> pool;
+};
 
-	parallax.x = layer.getParallax().x;
-	parallax.y = layer.getParallax().y;
+void MapLayer::set_tiles(const std::vector<Tile>& rows) {
+	setup_bricks();
 
-	offset.x = layer.getOffset().x;
-	offset.y = layer.getOffset().y;
+	auto storage = std::make_shared<BrickStorage>();
+	storage->bricks.resize(bricks_x * bricks_y);
 
-	scroll_speed.x = layer.get<float>("Scroll Speed X");
-	scroll_speed.y = layer.get<float>("Scroll Speed Y");
+	// Go through the bricks block by block, so the stored bricks of a block are together
+	for (int block = 0; block < blocks_x * blocks_y; block++)
+	for (int n = 0; n < bricks_per_block * bricks_per_block; n++) {
+		const int brick_x = (block % blocks_x) * bricks_per_block + n % bricks_per_block;
+		const int brick_y = (block / blocks_x) * bricks_per_block + n / bricks_per_block;
+		if (brick_x >= bricks_x || brick_y >= bricks_y) continue;
 
-	auto file_tint = layer.getTintColor();
-	if ( file_tint != tson::Colori(0, 0, 0, 255) ) // Don't set tint if it is black
-		tint = rgba(file_tint.r, file_tint.g, file_tint.b, file_tint.a);
+		Tile brick[brick_area];
+		bool filled = true;
 
-	if ( layer.getType() == tson::LayerType::ImageLayer ) {
-		type = LayerType::IMAGE;
-		this->texture = LoadTexture( ( map_path + layer.getImage() ).c_str() );
-		return;
+		for (int i = 0; i < brick_area; i++) {
+			const int x = brick_x * brick_size + i % brick_size;
+			const int y = brick_y * brick_size + i / brick_size;
+
+			brick[i] = (x < width && y < height) ? rows[y * width + x] : empty_tile;
+			filled &= brick[i] == brick[0];
+		}
+
+		uint32_t& entry = storage->bricks[brick_y * bricks_x + brick_x];
+		if (filled) {
+			entry = brick_fill | (unsigned char)brick[0];
+			continue;
+		}
+
+		entry = storage->pool.size() / brick_area;
+		storage->pool.insert(storage->pool.end(), brick, brick + brick_area);
 	}
 
-	type = LayerType::TILE;
+	bricks = storage->bricks.data();
+	brick_pool = storage->pool.data();
+	tile_storage = storage;
+	index_bricks();
+}
 
-	// Invert parallax for tile layers
-	parallax.x = 1.0 - layer.getParallax().x;
-	parallax.y = 1.0 - layer.getParallax().y;
+void MapLayer::map_tiles(std::shared_ptr<const MappedFile> file, const uint32_t* bricks, const Tile* brick_pool) {
+	setup_bricks();
+
+	this->bricks = bricks;
+	this->brick_pool = brick_pool;
+	this->file = file;
+	tile_storage = file;
+	index_bricks();
+}
+
+void MapLayer::index_bricks() {
+	// Chunks made of empty bricks are never baked. Worked out once at load from the brick index,
+	// which is always resident, so streaming a block in only has to mark it resident
+	const int bricks_per_chunk = chunk_size / brick_size;
+	for (int i = 0; i < chunks_x * chunks_y; i++) {
+		const int start_x = (i % chunks_x) * bricks_per_chunk;
+		const int start_y = (i / chunks_x) * bricks_per_chunk;
+
+		bool empty = true;
+		for (int y = start_y; y < std::min(start_y + bricks_per_chunk, bricks_y); y++)
+		for (int x = start_x; x < std::min(start_x + bricks_per_chunk, bricks_x); x++)
+			empty &= bricks[y * bricks_x + x] == (brick_fill | empty_tile);
+
+		chunks[i].empty = empty;
+	}
+
+	// Find the range of stored bricks each block pages in
+	for (int i = 0; i < blocks_x * blocks_y; i++) {
+		int first = INT32_MAX, last = -1;
+
+		for (int y = (i / blocks_x) * bricks_per_block; y < std::min( (i / blocks_x + 1) * bricks_per_block, bricks_y ); y++)
+		for (int x = (i % blocks_x) * bricks_per_block; x < std::min( (i % blocks_x + 1) * bricks_per_block, bricks_x ); x++) {
+			const uint32_t brick = bricks[y * bricks_x + x];
+			if (brick & brick_fill) continue;
+
+			first = std::min(first, (int)brick);
+			last = std::max(last, (int)brick);
+		}
+
+		TileBlock& block = blocks[i];
+		block.first_brick = last < 0 ? 0 : first;
+		block.brick_count = last < 0 ? 0 : last - first + 1;
+		block.resident = !file || block.brick_count == 0; // Fills and empty bricks don't need paging
+	}
+}
 
-	// Set the size
-	width = layer.getSize().x;
-	height = layer.getSize().y;
-	tiles.resize(width*height);
+void MapLayer::stream_blocks(TileCoord start, TileCoord end) {
+	const int load_margin = 1; // Blocks around the view paged in before the camera gets there
+	const int keep_margin = 2; // Blocks further away are released
 
-	// Setup the rectangle vector
-	rects.resize(19);
+	start = { start.x / chunks_per_block, start.y / chunks_per_block };
+	end = { end.x / chunks_per_block, end.y / chunks_per_block };
 
-	// Loop through tiles
-	bool image_loaded = false;
+	if ( loading && loading->remaining == 0 ) finish_loading();
 
-	std::map<std::tuple<int, int>, tson::Tile*> tile_data = layer.getTileData();
-	for (const auto& [id, tile] : tile_data) {
-		if (tile == nullptr) continue;
+	// Release blocks that are far from the view
+	for (size_t n = 0; n < resident_blocks.size();) {
+		const int i = resident_blocks[n];
+		const int x = i % blocks_x;
+		const int y = i / blocks_x;
 
-		// Load the tileset texture
-		if (!image_loaded) {
-			auto texture_path = map_path + tile->getTileset()->getImage().generic_string();
-			this->texture = LoadTexture( texture_path.c_str() );
-			image_loaded = true;
+		if ( x >= start.x - keep_margin && x <= end.x + keep_margin && y >= start.y - keep_margin && y <= end.y + keep_margin ) {
+			n++;
+			continue;
 		}
 
-		Tile new_tile = tile->getGid();
+		file->release( (const unsigned char*)( brick_pool + blocks[i].first_brick * brick_area ) - file->data(), blocks[i].brick_count * brick_area );
+		blocks[i].resident = false;
+
+		resident_blocks[n] = resident_blocks.back();
+		resident_blocks.pop_back();
+	}
+
+	if (loading) return; // One load at a time
+
+	for (int y = std::max(start.y - load_margin, 0); y <= std::min(end.y + load_margin, blocks_y - 1); y++)
+	for (int x = std::max(start.x - load_margin, 0); x <= std::min(end.x + load_margin, blocks_x - 1); x++) {
+		TileBlock& block = blocks[y * blocks_x + x];
+		if (block.resident || block.loading) continue;
+
+		block.loading = true;
+		loading_blocks.push_back(y * blocks_x + x);
+	}
+
+	if ( loading_blocks.empty() ) return;
+
+	// Page the blocks in on a worker so drawing doesn't wait on the disk
+	std::vector< std::pair<size_t, size_t> > ranges;
+	for (int i : loading_blocks) {
+		const size_t offset = (const unsigned char*)( brick_pool + blocks[i].first_brick * brick_area ) - file->data();
+		ranges.push_back( {offset, size_t(blocks[i].brick_count) * brick_area} );
+	}
 
-		// Get tile position
-		auto [cx, cy] = id;
-		TileCoord coord = {cx, cy};
+	loading = std::make_shared<JobGroup>();
+	JobSystem::submit( *loading, [file = file, ranges, group = loading]() {
+		for (auto [offset, size] : ranges) file->prefetch(offset, size);
+	} );
 
-		// Add it to the vector of tiles
-		tiles[ tile_index(coord) ] = new_tile;
+	// Blocks that are already on screen can't wait for the next frame
+	for (int i : loading_blocks) {
+		const int x = i % blocks_x;
+		const int y = i / blocks_x;
+		if (x < start.x || x > end.x || y < start.y || y > end.y) continue;
 
-		// Add the drawing rectangle to the rects vector
-		auto file_rect = tile->getDrawingRect();
-		rects[new_tile].x = file_rect.x;
-		rects[new_tile].y = file_rect.y;
-		rects[new_tile].width = file_rect.width;
-		rects[new_tile].height = file_rect.height;
+		JobSystem::wait(*loading);
+		finish_loading();
+		break;
 	}
 }
 
-void MapLayer::draw() {
+void MapLayer::finish_loading() {
+	for (int i : loading_blocks) {
+		blocks[i].loading = false;
+		blocks[i].resident = true;
+		resident_blocks.push_back(i);
+	}
+
+	loading_blocks.clear();
+	loading.reset();
+}
+
+vec2 MapLayer::layer_shift() const {
+	const vec2 target = CameraSystem::get_camera().target;
+	return vec2( offset.x + parallax.x * target.x, offset.y + parallax.y * target.y );
+}
+
+void MapLayer::visible_chunks(TileCoord& start, TileCoord& end) const {
+	const vec2 shift = layer_shift();
+	const float chunk_pixels = chunk_size * tile_size;
+
+	vec2 min_corner = vec2( CameraSystem::get_camera().GetScreenToWorld({0.0, 0.0}) ) - shift;
+	vec2 max_corner = vec2( CameraSystem::get_camera().GetScreenToWorld({(float)Viewport::get_width(), (float)Viewport::get_height()}) ) - shift;
+
+	// Chunks outside the layer aren't drawn
+	start.x = std::max( (int)floor(min_corner.x / chunk_pixels), 0 );
+	start.y = std::max( (int)floor(min_corner.y / chunk_pixels), 0 );
+	end.x = std::min( (int)floor(max_corner.x / chunk_pixels), chunks_x - 1 );
+	end.y = std::min( (int)floor(max_corner.y / chunk_pixels), chunks_y - 1 );
+}
+
+void MapLayer::bake_chunk(TileChunk& chunk, int chunk_x, int chunk_y, int level) {
+	const int size = (chunk_size * tile_size) >> level;
+	RenderTexture2D& target = chunk.lods[level];
+	target = LoadRenderTexture(size, size);
+
+	// Copy pixels as they are instead of blending them with the empty texture
+	BeginTextureMode(target);
+	BeginBlendMode(BLEND_ADD_COLORS);
+	ClearBackground(BLANK);
+
+	if (level == 0) {
+		for (int y = 0; y < chunk_size; y++)
+		for (int x = 0; x < chunk_size; x++) {
+			const int tile_x = chunk_x * chunk_size + x;
+			const int tile_y = chunk_y * chunk_size + y;
+			if (tile_x >= width || tile_y >= height) continue;
+
+			const Tile t = (*this)(tile_x, tile_y);
+			if (t == empty_tile) continue;
+
+			Rectangle dest = { float(x * tile_size), float(y * tile_size), float(tile_size), float(tile_size) };
+			DrawTexturePro(texture, rects[t], dest, {0.0, 0.0}, 0.0, WHITE);
+		}
+	} else {
+		// Average the level above, filtering each 2x2 block of pixels into one
+		const Texture2D& source = chunk.lods[level - 1].texture;
+		SetTextureFilter(source, TEXTURE_FILTER_BILINEAR);
+		DrawTexturePro(
+			source,
+			{0.0, 0.0, (float)source.width, -(float)source.height},
+			{0.0, 0.0, (float)size, (float)size},
+			{0.0, 0.0},
+			0.0,
+			WHITE
+		);
+		if (level == 1) SetTextureFilter(source, TEXTURE_FILTER_POINT); // Full size stays pixelated
+	}
+
+	EndBlendMode();
+	EndTextureMode();
+
+	if (level > 0) SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);
+}
+
+void MapLayer::prepare(int frame) {
 	offset += scroll_speed * GetFrameTime();
 
-	if (type == LayerType::TILE) draw_tile();
-	else if (type == LayerType::IMAGE) draw_image();
+	if (type == LayerType::IMAGE) {
+		// Work out the part of the image on screen, the compositor checks if it moved
+		const Rectangle area = screen_area();
+		last_source = source;
+		source = {
+			(parallax.x * area.x) + offset.x,
+			(parallax.y * area.y) - offset.y,
+			(float)GetScreenWidth(),
+			(float)GetScreenHeight()
+		};
+		return;
+	}
+
+	const int chunk_lifetime = 300; // Frames a chunk stays baked off screen
+
+	// Use smaller textures when zoomed out
+	const float zoom = CameraSystem::get_camera().zoom;
+	lod = std::clamp( (int)floor( log2(1.0 / zoom) + 0.5 ), 0, lod_count - 1 );
+
+	TileCoord start, end;
+	visible_chunks(start, end);
+	if (file) stream_blocks(start, end);
+
+	for (int y = start.y; y <= end.y; y++)
+	for (int x = start.x; x <= end.x; x++) {
+		TileChunk& chunk = chunks[y * chunks_x + x];
+		if ( chunk.empty || !blocks[ (y / chunks_per_block) * blocks_x + x / chunks_per_block ].resident ) continue;
+
+		chunk.last_seen = frame;
+		if ( !Renderer::has_gpu() ) continue; // Nothing to bake into
+		for (int level = 0; level <= lod; level++)
+			if (chunk.lods[level].id == 0) bake_chunk(chunk, x, y, level);
+	}
+
+	// Free chunks that haven't been seen for a while
+	for (auto& chunk : chunks) {
+		if (chunk.lods[0].id == 0 || frame - chunk.last_seen < chunk_lifetime) continue;
+
+		for (auto& level : chunk.lods) {
+			if (level.id != 0) UnloadRenderTexture(level);
+			level = {};
+		}
+	}
 }
 
-int MapLayer::tile_index(const int x, const int y) const {
-	return width * y + x;
+void MapLayer::unload() {
+	for (auto& chunk : chunks)
+	for (auto& level : chunk.lods) {
+		if (level.id != 0) UnloadRenderTexture(level);
+		level = {};
+	}
 }
 
-int MapLayer::tile_index(const TileCoord t) const {
-	return width * t.y + t.x;
+void MapLayer::draw_image(Rectangle dest) const {
+	// The texture repeats, so the whole screen is one wrapped quad however far the layer has scrolled
+	Renderer::texture(
+		texture,
+		source,
+		dest,
+		(Vector2) { 0, 0 },
+		0,
+		tint
+	);
 }
 
-TileCoord MapLayer::tile_coord(const int i) const {
-	return {i%width, i/width};
+void MapLayer::composite(Rectangle dest) const {
+	DrawTexturePro(texture, source, dest, (Vector2) { 0, 0 }, 0, tint); // Straight into the cache being drawn
+}
+
+MapLayer::MapLayer(const LayerInfo& info, std::shared_ptr<const Rectangle[]> rects)
+	: type(info.type), parallax(info.parallax), offset(info.offset), scroll_speed(info.scroll_speed),
+	  reapeat_x(info.repeat_x), reapeat_y(info.repeat_y), rects(rects), tint(info.tint), width(info.width), height(info.height)
+{
+	bool image_opaque = false;
+	texture = load_texture_cached(info.image, &image_opaque);
+
+	if (type == LayerType::IMAGE) {
+		if ( Renderer::has_gpu() ) SetTextureWrap(texture, TEXTURE_WRAP_REPEAT);
+		opaque = image_opaque && tint.a == 255;
+		return;
+	}
+
+	// Invert parallax for tile layers
+	parallax.x = 1.0 - info.parallax.x;
+	parallax.y = 1.0 - info.parallax.y;
 }
+
+void MapLayer::draw() {
+	if (type == LayerType::TILE) draw_tile();
+	else if (type == LayerType::IMAGE) draw_image( screen_area() );
+}
+
 Tile MapLayer::operator()(const int x, const int y) const { // Getter
-	return tiles[ tile_index(x, y) ];
+	const uint32_t brick = bricks[ (y / brick_size) * bricks_x + x / brick_size ];
+	if (brick & brick_fill) return Tile(brick & 0xff);
+
+	return brick_pool[ brick * brick_area + (y % brick_size) * brick_size + x % brick_size ];
 }
+
 Tile MapLayer::operator()(const TileCoord t) const { // Getter
-	return tiles[ tile_index(t) ];
+	return (*this)(t.x, t.y);
 }
@@ -2,8 +2,11 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
 #include <raylib.h>
-#include <tileson.hpp>
 
 #include "typedefs.hh"
 
@@ -14,35 +17,108 @@ struct TileCoord {
 	int x, y;
 };
 
+const int brick_size = 8; // Tiles along each side of a brick, whose tiles fill one cache line
+const int brick_area = brick_size * brick_size;
+const uint32_t brick_fill = 0x80000000; // Marks bricks filled with one tile, which is in the low bits
+const int chunk_size = 16; // Tiles along each side of a chunk
+const int block_size = 64; // Tiles along each side of a streamed block, whose bricks fill a 4 KB page
+const int chunks_per_block = block_size / chunk_size;
+const int bricks_per_block = block_size / brick_size;
+const int lod_count = 3; // Each level of detail is half the size of the one before
+
+class MappedFile;
+struct JobGroup;
+
+// Part of a tile layer baked into textures
+struct TileChunk {
+	RenderTexture2D lods[lod_count] = {};
+	bool empty = true;
+	int last_seen = 0; // Frame the chunk was last on screen
+};
+
+// Part of a tile layer that is paged in and out together
+struct TileBlock {
+	int first_brick = 0, brick_count = 0; // Stored bricks of the block, which are next to each other
+	bool resident = true; // Streamed blocks are paged in before their chunks are baked
+	bool loading = false;
+};
+
 enum class LayerType {
 	TILE,
 	IMAGE,
 };
 
+// Settings for a layer, as they are in the level file
+struct LayerInfo {
+	LayerType type = LayerType::TILE;
+	vec2 parallax = vec2(1.0, 1.0);
+	vec2 offset = vec2(0.0, 0.0);
+	vec2 scroll_speed = vec2(0.0, 0.0);
+	rgba tint = WHITE;
+	bool repeat_x = false, repeat_y = false;
+	int width = 0, height = 0;
+	std::string image; // Path of the image or tileset
+};
+
 class MapLayer {
 private:
 	LayerType type;
-	std::vector<Tile> tiles;
+	std::shared_ptr<const void> tile_storage; // Memory the bricks point into
+
+	// Each brick is either a fill or an index into the pool of stored bricks
+	const uint32_t* bricks = nullptr;
+	const Tile* brick_pool = nullptr;
+	int bricks_x, bricks_y;
 	vec2 parallax, offset, scroll_speed;
 	Texture2D texture;
 	bool reapeat_x, reapeat_y;
-	std::vector<Rectangle> rects; // Vector of drawing rects
+	std::shared_ptr<const Rectangle[]> rects; // Drawing rects indexed by tile
 	rgba tint = WHITE;
+	bool opaque = false; // Image layer with no see-through pixels, which hides everything behind it
+	Rectangle source = {}, last_source = {}; // Part of the image on screen this frame and the one before
+
+	std::vector<TileChunk> chunks;
+	int chunks_x, chunks_y;
+	int lod = 0; // Level of detail drawn this frame
+
+	std::vector<TileBlock> blocks;
+	int blocks_x, blocks_y;
+
+	// Streaming from a cooked level. Only which pages of the brick pool are in memory follows the view:
+	// the whole file stays mapped, and the brick index, chunks, blocks and the map's spawn table cover the whole level
+	std::shared_ptr<const MappedFile> file;
+	std::shared_ptr<JobGroup> loading; // Blocks being paged in by a job
+	std::vector<int> loading_blocks;
+	std::vector<int> resident_blocks;
 
 	void draw_tile() const;
-	void draw_image() const;
+	void draw_image(Rectangle dest) const;
+
+	vec2 layer_shift() const; // Where the layer is drawn after parallax and offset
+	void setup_bricks();
+	void index_bricks(); // Finds empty chunks and the bricks in each block
+	void stream_blocks(TileCoord start, TileCoord end); // Loads blocks near the visible chunks and releases far ones
+	void finish_loading();
+	void visible_chunks(TileCoord& start, TileCoord& end) const;
+	void bake_chunk(TileChunk& chunk, int chunk_x, int chunk_y, int level);
 
 public:
 	int width, height;
 	int tile_size = 32;
 
 	MapLayer() = default;
-	MapLayer(const std::string filename, tson::Layer& layer);
+	MapLayer(const LayerInfo& info, std::shared_ptr<const Rectangle[]> rects = nullptr);
+	void set_tiles(const std::vector<Tile>& rows); // Copies tiles stored row by row into bricks
+	void map_tiles(std::shared_ptr<const MappedFile> file, const uint32_t* bricks, const Tile* brick_pool); // Streams bricks from a cooked level
 	void draw();
+	void prepare(int frame); // Bakes visible chunks, must be called outside of drawing
+	void unload();
+	void composite(Rectangle dest) const; // Draws the image into a layer cache
 
-	int tile_index(const int x, const int y) const;
-	int tile_index(const TileCoord t) const;
-	TileCoord tile_coord(const int i) const;
+	bool is_image() const { return type == LayerType::IMAGE; }
+	bool is_opaque() const { return opaque; }
+	bool is_still() const { return is_image() && source.x == last_source.x && source.y == last_source.y; } // Hasn't moved since the last frame
+	Rectangle image_source() const { return source; }
 
 	Tile operator()(const int x, const int y) const;
 	Tile operator()(const TileCoord t) const;
@@ -51,16 +127,52 @@ public:
 class Tilemap {
 private:
 	std::vector<MapLayer> layers;
-	int main_layer; // Index of main layer
+	int main_layer = 0; // Index of main layer
+	int frame = 0; // Frames drawn, used to evict unseen chunks
+
+	// One bit per tile of the main layer in 8x8 tile bricks, with an empty border one tile wide
+	std::vector<uint64_t> solid_mask;
+	int mask_stride; // Bricks in each row of the mask
+
+	// Objects are spawned the first time the camera comes close to their chunk
+	struct Spawn {
+		std::string type;
+		vec2 position;
+	};
+
+	std::vector< std::vector<Spawn> > spawns; // Waiting objects in each chunk
+	std::vector<bool> spawned;
+	int spawn_chunks_x, spawn_chunks_y;
+
+	// Image layers that stay still are composited into one screen sized texture
+	struct LayerCache {
+		int count = 0; // Layers drawn by the cache this frame, starting with its own
+		RenderTexture2D target = {};
+		std::vector<Rectangle> sources; // Where each layer was when the cache was drawn
+	};
+
+	std::vector<LayerCache> layer_caches; // One for each layer, only used when a run of still layers starts there
+	int first_layer = 0; // Layers behind an opaque image aren't drawn
+
+	void composite_layers();
+	void update_cache(LayerCache& cache, int first);
+	void build_solid_mask();
+	void setup_spawns();
+	void add_spawn(const std::string type, vec2 position);
+	bool load_json(const std::string filename); // Returns false if the level couldn't be loaded
+	bool load_cooked(const std::string filename); // Loads a level made by working/cook_level.py, returns false if it couldn't be
 
 public:
-	int width, height;
+	int width = 0, height = 0;
 	int tile_size = 32;
 
 	int tile_index(const int x, const int y) const;
 	int tile_index(const TileCoord t) const;
 	TileCoord tile_coord(const int i) const;
 	void draw();
+	void prepare(); // Bakes chunks for this frame before drawing starts
+	void unload();
+	void spawn_objects(raylib::Rectangle area); // Spawns objects near the area that haven't been spawned
 
 	TileCoord world_to_tile(const Vector2 position) const; // Gets the tile coordinate from world coordinate
 	TileCoord world_to_tile(float x, float y) const;
@@ -72,8 +184,52 @@ public:
 	Tile operator()(const int x, const int y) const; // Getter
 	Tile operator()(const TileCoord t) const;
 
+	// Collision queries, coordinates outside the map land on the empty border
+	bool solid(const int x, const int y) const {
+		return solid_box(x, y, x, y);
+	}
+
+	bool solid(const TileCoord t) const {
+		return solid_box(t.x, t.y, t.x, t.y);
+	}
+
+	bool solid_point(float x, float y) const { // Tile under a world position, one word read and no loops for batched callers
+		const int tile_x = std::clamp( (int)floor(x / tile_size), -1, width ) + 1;
+		const int tile_y = std::clamp( (int)floor(y / tile_size), -1, height ) + 1;
+		const uint64_t bit = uint64_t(1) << ( (tile_y & 7) * 8 + (tile_x & 7) );
+		return solid_mask[(tile_y >> 3) * mask_stride + (tile_x >> 3)] & bit;
+	}
+
+	bool solid_span(int start_x, int end_x, int y) const { // True if any tile in part of a row is solid
+		return solid_box(start_x, y, end_x, y);
+	}
+
+	bool solid_box(int start_x, int start_y, int end_x, int end_y) const { // True if any tile in a box is solid
+		start_x = std::clamp(start_x, -1, width) + 1;
+		end_x = std::clamp(end_x, -1, width) + 1;
+		start_y = std::clamp(start_y, -1, height) + 1;
+		end_y = std::clamp(end_y, -1, height) + 1;
+
+		// Each brick is a word with a byte for each row, so a collider only reads a few words
+		for (int brick_y = start_y / 8; brick_y <= end_y / 8; brick_y++) {
+			const int row_start = std::max(start_y - brick_y * 8, 0);
+			const int row_end = std::min(end_y - brick_y * 8, 7);
+			const uint64_t rows = ( ~uint64_t(0) << (row_start * 8) ) & ( ~uint64_t(0) >> (56 - row_end * 8) );
+
+			for (int brick_x = start_x / 8; brick_x <= end_x / 8; brick_x++) {
+				const int column_start = std::max(start_x - brick_x * 8, 0);
+				const int column_end = std::min(end_x - brick_x * 8, 7);
+				const uint64_t columns = uint64_t( (0xffu << column_start) & (0xffu >> (7 - column_end)) ) * 0x0101010101010101;
+
+				if ( solid_mask[brick_y * mask_stride + brick_x] & rows & columns ) return true;
+			}
+		}
+
+		return false;
+	}
+
 	Tilemap() = default;
-	Tilemap(const std::string filename);
+	Tilemap(const std::string filename); // Takes a Tiled JSON map or a cooked .lvl file
 	virtual ~Tilemap () {
 		// UnloadTexture(texture);
 	}
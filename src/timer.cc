@@ -1,5 +1,6 @@
 #include <raylib-cpp.hpp>
 
+#include "globals.hh"
 #include "timer.hh"
 
 Timer::Timer( float time, void(* function)() ) {
@@ -11,7 +12,7 @@ Timer::Timer( float time, void(* function)() ) {
 void Timer::update() {
 	if (!active) return;
 
-	time -= GetFrameTime(); // Count down
+	time -= tick_length; // Count down
 	if (time > 0.0) return;
 
 	function(); // Call function when time runs out
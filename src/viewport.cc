@@ -0,0 +1,98 @@
+#include <iostream>
+#include <algorithm>
+#include <string>
+#include <raylib-cpp.hpp>
+#include <rlgl.h>
+#include <toml.hpp>
+#include <magic_enum.hpp>
+
+#include "globals.hh"
+#include "viewport.hh"
+#include "renderer.hh"
+
+void Viewport::load_config() {
+	width = screen_width;
+	height = screen_height;
+
+	const auto data = toml::parse("config.cfg");
+	if ( !data.contains("Graphics") ) return;
+	const auto& graphics = toml::find(data, "Graphics");
+
+	// A fixed height keeps pixel art at one size, otherwise the world is drawn at a fraction of the window
+	const int render_height = toml::find_or<int>(graphics, "render_height", 0);
+	const float render_scale = std::clamp( toml::find_or<float>(graphics, "render_scale", 1.0), 0.25f, 1.0f );
+
+	height = render_height > 0 ? std::min(render_height, screen_height) : int(screen_height * render_scale);
+	width = int( float(screen_width) * height / screen_height + 0.5 ); // Same shape as the window
+
+	const std::string filter_name = toml::find_or<std::string>(graphics, "upscale_filter", "UPSCALE_NEAREST");
+	filter = magic_enum::enum_cast<UpscaleFilter>(filter_name).value_or(UPSCALE_NEAREST);
+
+	if ( scaled() ) std::cout << "Drawing the world at " << width << "x" << height << '\n';
+}
+
+void Viewport::init() {
+	if ( !scaled() || !Renderer::has_gpu() ) return;
+
+	target = LoadRenderTexture(width, height);
+	SetTextureFilter(target.texture, filter == UPSCALE_BILINEAR ? TEXTURE_FILTER_BILINEAR : TEXTURE_FILTER_POINT);
+
+	if (filter == UPSCALE_SHARP) {
+		// Rounded up, so the bilinear pass only ever scales down a little
+		const int multiple = (screen_height + height - 1) / height;
+		prescaled = LoadRenderTexture(width * multiple, height * multiple);
+		SetTextureFilter(prescaled.texture, TEXTURE_FILTER_BILINEAR);
+	}
+
+	rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD); // BLEND_CUSTOM replaces what's there, for copying targets
+}
+
+void Viewport::unload() {
+	if (target.id != 0) UnloadRenderTexture(target);
+	if (prescaled.id != 0) UnloadRenderTexture(prescaled);
+	target = {};
+	prescaled = {};
+}
+
+float Viewport::get_scale() {
+	return float(height) / float(screen_height);
+}
+
+bool Viewport::scaled() {
+	return width != screen_width || height != screen_height;
+}
+
+void Viewport::begin() {
+	if (target.id != 0) Renderer::begin_target(target);
+}
+
+void Viewport::end() {
+	if (target.id == 0) return;
+	Renderer::end_target();
+
+	// The world covers the whole window, so it's copied rather than blended
+	Renderer::blend_mode(BLEND_CUSTOM);
+
+	if (prescaled.id != 0) {
+		Renderer::begin_target(prescaled);
+		copy( target, { 0, 0, (float)prescaled.texture.width, (float)prescaled.texture.height } );
+		Renderer::end_target();
+		copy( prescaled, { 0, 0, (float)screen_width, (float)screen_height } );
+	} else {
+		copy( target, { 0, 0, (float)screen_width, (float)screen_height } );
+	}
+
+	Renderer::blend_mode(BLEND_ALPHA);
+}
+
+void Viewport::copy(const RenderTexture2D& source, Rectangle dest) {
+	// Render textures are upside down
+	Renderer::texture(
+		source.texture,
+		{ 0, 0, (float)source.texture.width, -(float)source.texture.height },
+		dest,
+		{ 0, 0 },
+		0,
+		WHITE
+	);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <raylib-cpp.hpp>
+
+enum UpscaleFilter {
+	UPSCALE_NEAREST,
+	UPSCALE_BILINEAR,
+	UPSCALE_SHARP, // Nearest to a whole multiple, then bilinear the rest of the way
+};
+
+// Draws the world at a lower resolution than the window and scales it up, so fill cost doesn't grow with the window
+class Viewport {
+private:
+	inline static int width = 0, height = 0; // Internal resolution of the world
+	inline static UpscaleFilter filter = UPSCALE_NEAREST;
+	inline static RenderTexture2D target = {}; // World at the internal resolution
+	inline static RenderTexture2D prescaled = {}; // Sharp filtering scales up by a whole number into this first
+
+	static void copy(const RenderTexture2D& source, Rectangle dest); // Draws a target without blending
+
+public:
+	static void load_config(); // Reads the internal resolution from config.cfg, before the window opens
+	static void init(); // Makes the targets once there's a window
+	static void unload();
+
+	static int get_width() { return width; }
+	static int get_height() { return height; }
+	static float get_scale(); // Internal resolution over the window's
+	static bool scaled(); // False when the world is drawn straight to the window
+
+	static void begin(); // World draws after this go into the target
+	static void end(); // Scales the target up to the window
+	Viewport() = delete;
+};
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <vector>
 #include <entt/entt.hpp>
 #include <toml.hpp>
+#include <raylib-cpp.hpp>
 
 // The default range for Magic Enum is [-128, 128]
 #define MAGIC_ENUM_RANGE_MIN 0
@@ -22,8 +24,12 @@ public:
 	virtual void fire() = 0;
 	virtual void update() = 0;
 	virtual void end() = 0;
+
+	entt::entity get_owner() const { return owner; }
 };
 
+class Shield;
+
 class Gun : public Weapon {
 private:
 	int damage;		// Damage of each bullet
@@ -32,6 +38,18 @@ private:
 	float spread;		// Spread when bullets are fired
 	float speed;		// Speed of each bullet
 	float rate;		// Time between shots
+	bool hitscan;		// Bullets hit instantly instead of travelling
+	float range;		// Furthest distance a hitscan bullet reaches
+
+	struct Tracer {
+		vec2 start, end;
+		float age;
+	};
+
+	inline static std::vector<Tracer> tracers; // Visible paths of hitscan bullets
+
+	void trace(vec2 start, vec2 direction); // Fires one hitscan bullet
+	static Shield* find_shield(vec2 start, vec2 motion, entt::entity shooter, float& time); // First shield a hitscan bullet meets before time
 
 public:
 	Gun() = default;
@@ -40,6 +58,10 @@ public:
 	void fire();
 	void update();
 	void end();
+
+	static void update_tracers();
+	static void draw_tracers();
+	static void clear_tracers();
 };
 
 class Melee : public Weapon {
@@ -91,6 +113,9 @@ public:
 	void fire();
 	void update();
 	void end();
+
+	bool blocking_area(raylib::Rectangle& area) const; // Where bullets are blocked, false outside the blocking window
+	bool deflects() const { return deflect; }
 };
 
 class Charge : public Weapon {
@@ -0,0 +1,209 @@
+# Cooks a Tiled JSON map into the binary level format read by Tilemap
+# Usage: python cook_level.py assets/levels/test.json [assets/levels/test.lvl]
+
+import json
+import struct
+from sys import argv
+from os.path import splitext
+
+MAGIC = b'BLVL'
+VERSION = 3
+
+HEADER = struct.Struct('<4sIiiiIIIIII')
+LAYER = struct.Struct('<Iffffff4BIIiiIIIII')
+SPAWN = struct.Struct('<ffI')
+RECT = struct.Struct('<ffff')
+
+TILE_LAYER = 0
+IMAGE_LAYER = 1
+
+GID_MASK = 0x0fffffff # Removes the flip flags
+
+BRICK_SIZE = 8 # Tiles along each side of a brick, one brick fills a cache line
+BRICK_FILL = 0x80000000 # Marks bricks filled with one tile
+BLOCK_SIZE = 64 # Tiles along each side of a block, the stored bricks of a block fill a page
+PAGE_SIZE = 4096
+
+def property_value(layer, name, default=0.0):
+	for prop in layer.get('properties', []):
+		if prop['name'] == name: return prop['value']
+	return default
+
+def tint(layer):
+	# Tiled colors are #RRGGBB or #AARRGGBB
+	color = layer.get('tintcolor')
+	if color is None: return (255, 255, 255, 255)
+
+	color = color.lstrip('#')
+	alpha = 255
+	if len(color) == 8:
+		alpha = int(color[0:2], 16)
+		color = color[2:]
+
+	rgba = (int(color[0:2], 16), int(color[2:4], 16), int(color[4:6], 16), alpha)
+	if rgba == (0, 0, 0, 255): return (255, 255, 255, 255) # Black means no tint
+	return rgba
+
+def tileset_for(tilesets, gid):
+	for tileset in sorted(tilesets, key=lambda t: t['firstgid'], reverse=True):
+		if gid >= tileset['firstgid']: return tileset
+
+def tile_rect(tileset, gid):
+	index = gid - tileset['firstgid']
+	margin = tileset.get('margin', 0)
+	spacing = tileset.get('spacing', 0)
+	width, height = tileset['tilewidth'], tileset['tileheight']
+
+	x = margin + (index % tileset['columns']) * (width + spacing)
+	y = margin + (index // tileset['columns']) * (height + spacing)
+	return (x, y, width, height)
+
+class Writer:
+	def __init__(self):
+		self.data = bytearray()
+
+	def align(self, alignment=4):
+		while len(self.data) % alignment: self.data.append(0)
+
+	def add(self, chunk, alignment=4):
+		self.align(alignment)
+		offset = len(self.data)
+		self.data += chunk
+		return offset
+
+	def add_string(self, text):
+		return self.add( text.encode('utf-8') + b'\0' )
+
+def add_bricks(writer, gids, width, height):
+	# Bricks of one tile all over are stored as that tile, others go in a pool where each block starts on a new page
+	bricks_x = (width + BRICK_SIZE - 1) // BRICK_SIZE
+	bricks_y = (height + BRICK_SIZE - 1) // BRICK_SIZE
+	per_block = BLOCK_SIZE // BRICK_SIZE
+	per_page = PAGE_SIZE // (BRICK_SIZE * BRICK_SIZE)
+
+	bricks = [0] * (bricks_x * bricks_y)
+	pool = bytearray()
+
+	for block_y in range(0, bricks_y, per_block):
+		for block_x in range(0, bricks_x, per_block):
+			count = len(pool) // (BRICK_SIZE * BRICK_SIZE)
+			if count % per_page: pool += bytes( (per_page - count % per_page) * BRICK_SIZE * BRICK_SIZE )
+
+			for brick_y in range(block_y, min(block_y + per_block, bricks_y)):
+				for brick_x in range(block_x, min(block_x + per_block, bricks_x)):
+					brick = bytearray(BRICK_SIZE * BRICK_SIZE)
+					for i in range(BRICK_SIZE * BRICK_SIZE):
+						x = brick_x * BRICK_SIZE + i % BRICK_SIZE
+						y = brick_y * BRICK_SIZE + i // BRICK_SIZE
+						if x < width and y < height: brick[i] = gids[y * width + x]
+
+					if brick.count(brick[0]) == len(brick):
+						bricks[brick_y * bricks_x + brick_x] = BRICK_FILL | brick[0]
+					else:
+						bricks[brick_y * bricks_x + brick_x] = len(pool) // len(brick)
+						pool += brick
+
+	table = writer.add( struct.pack(f'<{len(bricks)}I', *bricks) )
+	return table, writer.add(bytes(pool), PAGE_SIZE)
+
+def solid_mask(gids, width, height):
+	# Same layout as Tilemap::solid_mask, 8x8 tile bricks with an empty border one tile wide
+	stride = (width + 2 + 7) // 8
+	words = [0] * (stride * ((height + 2 + 7) // 8))
+
+	for y in range(height):
+		for x in range(width):
+			if gids[y * width + x] == 0: continue
+			mask_x, mask_y = x + 1, y + 1
+			words[(mask_y // 8) * stride + mask_x // 8] |= 1 << ((mask_y % 8) * 8 + mask_x % 8)
+
+	return struct.pack(f'<{len(words)}Q', *words)
+
+def cook(source, destination):
+	with open(source) as file:
+		level = json.load(file)
+
+	writer = Writer()
+	writer.add( bytes(HEADER.size) ) # Filled in at the end
+
+	layers = []
+	spawns = []
+	main_layer = 0
+	mask = 0
+
+	for layer in level['layers']:
+		if layer['type'] == 'objectgroup':
+			for obj in layer.get('objects', []):
+				spawns.append( (float(int(obj['x'])), float(int(obj['y'])), writer.add_string(obj.get('type', ''))) )
+			continue
+
+		if layer['type'] not in ('tilelayer', 'imagelayer'): continue
+		if layer['name'] == 'Main': main_layer = len(layers)
+
+		record = {
+			'parallax': (layer.get('parallaxx', 1.0), layer.get('parallaxy', 1.0)),
+			'offset': (layer.get('offsetx', 0.0), layer.get('offsety', 0.0)),
+			'scroll': (property_value(layer, 'Scroll Speed X'), property_value(layer, 'Scroll Speed Y')),
+			'tint': tint(layer),
+			'repeat': (int(layer.get('repeatx', False)), int(layer.get('repeaty', False))),
+			'size': (0, 0),
+			'bricks': 0,
+			'brick_pool': 0,
+			'rects': 0,
+			'rect_count': 0,
+		}
+
+		if layer['type'] == 'imagelayer':
+			record['type'] = IMAGE_LAYER
+			record['image'] = writer.add_string(layer['image'])
+			layers.append(record)
+			continue
+
+		record['type'] = TILE_LAYER
+		record['size'] = (layer['width'], layer['height'])
+
+		gids = [gid & GID_MASK for gid in layer['data']]
+		if max(gids) > 127: raise ValueError(f"{layer['name']} uses more tiles than fit in a Tile")
+		record['bricks'], record['brick_pool'] = add_bricks(writer, gids, layer['width'], layer['height'])
+		if layer['name'] == 'Main': mask = writer.add( solid_mask(gids, layer['width'], layer['height']), 8 )
+
+		# Drawing rects are indexed by tile
+		used = [gid for gid in gids if gid != 0]
+		tileset = tileset_for(level['tilesets'], used[0]) if used else level['tilesets'][0]
+		rects = [ (0, 0, 0, 0) ] * (max(used, default=0) + 1)
+		for gid in set(used): rects[gid] = tile_rect(tileset, gid)
+
+		record['image'] = writer.add_string(tileset['image'])
+		record['rects'] = writer.add( b''.join(RECT.pack(*rect) for rect in rects) )
+		record['rect_count'] = len(rects)
+		layers.append(record)
+
+	layers_offset = writer.add( b''.join(
+		LAYER.pack(
+			layer['type'],
+			*layer['parallax'], *layer['offset'], *layer['scroll'],
+			*layer['tint'],
+			*layer['repeat'],
+			*layer['size'],
+			layer['image'], layer['bricks'], layer['brick_pool'], layer['rects'], layer['rect_count']
+		) for layer in layers
+	) )
+	spawns_offset = writer.add( b''.join(SPAWN.pack(*spawn) for spawn in spawns) )
+
+	main = [l for l in level['layers'] if l['type'] == 'tilelayer' and l['name'] == 'Main'][0]
+	writer.data[0:HEADER.size] = HEADER.pack(
+		MAGIC, VERSION,
+		main['width'], main['height'], level['tilewidth'],
+		main_layer,
+		len(layers), layers_offset,
+		len(spawns), spawns_offset,
+		mask
+	)
+
+	with open(destination, 'wb') as file:
+		file.write(writer.data)
+
+if __name__ == '__main__':
+	source = argv[1]
+	destination = argv[2] if len(argv) > 2 else splitext(source)[0] + '.lvl'
+	cook(source, destination)
@@ -1,8 +1,11 @@
 from PIL import Image
 from sys import argv
-from os import walk
+from os import walk, path
 from glob import glob
 from itertools import product
+import re
+
+SPRITES = path.join( path.dirname( path.abspath(__file__) ), '..', 'assets', 'graphics', 'sprites' ) # Where the game loads sprites from
 
 # CHARACTERS = ['guard']
 CHARACTERS = ['vampire']
@@ -135,9 +138,10 @@ def create_canvas(frames):
 	return canvas
 
 def create_sheet(character, canvas, frames):
-	# Copy frames onto canvas
+	# Copy frames onto canvas, returns the trim of each frame by row
 	x = 0
 	y = 0
+	trims = []
 
 	im = Image.open( frames['idle-right'][0] ) # sprite dimmensions
 	sprite_width = im.width
@@ -149,16 +153,46 @@ def create_sheet(character, canvas, frames):
 			continue
 
 		x = 0
+		row = []
 		for frame in frames[ f"{action}-{direction}" ]:
-			sprite = Image.open(frame)
+			sprite = Image.open(frame).convert('RGBA')
 			canvas.paste(sprite, (x,y))
 			x += sprite_width
 
+			# Bounds of the opaque pixels, empty frames get no size
+			box = sprite.getchannel('A').getbbox()
+			row.append( [box[0], box[1], box[2] - box[0], box[3] - box[1]] if box else [0, 0, 0, 0] )
+
+		trims.append(row)
 		y += sprite_height
 
+	return trims
+
+def write_trims(character, trims):
+	# Replace the trim table in the game's copy of the sprite's TOML, the rest is written by hand
+	filename = path.join(SPRITES, f'{character}.toml')
+	try:
+		with open(filename) as f:
+			text = f.read()
+	except FileNotFoundError:
+		text = ''
+
+	# Up to the next table, so the tables after it are kept
+	text = re.sub(r'^\[trim\].*?(?=^\[|\Z)', '', text, flags=re.S | re.M).rstrip() + '\n\n'
+	text += '[trim] # Opaque part of each frame: x, y, width, height in its cell, by row then column\n'
+	text += 'rows = [\n'
+	for row in trims:
+		text += '\t[' + ', '.join( '[{}, {}, {}, {}]'.format(*trim) for trim in row ) + '],\n'
+	text += ']\n'
+
+	with open(filename, 'w') as f:
+		f.write(text)
+	print(f'Wrote the trims to {filename}')
+
 for character in CHARACTERS:
 	frames = create_dict()
 	find_frames(character, frames)
 	canvas = create_canvas(frames)
-	create_sheet(character, canvas, frames)
-	canvas.save(f'{character}.png', 'PNG')
+	trims = create_sheet(character, canvas, frames)
+	canvas.save(path.join(SPRITES, f'{character}.png'), 'PNG') # Next to the trims worked out from it
+	write_trims(character, trims)